@@ -0,0 +1,39 @@
+#ifndef ACTIVATION_HPP
+#define ACTIVATION_HPP
+
+#include "matrix.hpp"
+#include <cmath>
+
+inline double expit(const double& val) {
+    return 1/(1 + std::exp(-val));
+}
+
+inline double logit(const double& val) {
+    auto value = (val<=0)? 0.01: (val>=1)? 0.99: val;
+    return  std::log(std::abs(value/(1-value)));
+}
+
+template<typename T>
+Matrix<T> activate(const Matrix<T>& matrix) {
+    PROFILE_SCOPE("activate");
+    auto mat = matrix;
+    for(int i=0; i<mat.getRows(); ++i) {
+        for(int j=0; j<mat.getCols(); ++j) {
+            mat[i][j] = expit(mat[i][j]);
+        }
+    }
+    return mat;
+}
+
+template<typename T>
+Matrix<T> reverseActivate(const Matrix<T>& matrix) {
+    auto mat = matrix;
+    for(int i=0; i<mat.getRows(); ++i) {
+        for(int j=0; j<mat.getCols(); ++j) {
+            mat[i][j] = logit(mat[i][j]);
+        }
+    }
+    return mat;
+}
+
+#endif
@@ -0,0 +1,74 @@
+#include "dnn.hpp"
+#include "model.hpp"
+#include <iostream>
+#include <iomanip>
+#include <chrono>
+#include <random>
+#include <cmath>
+
+// Compares the generated predict() with DNN::query on the model it was
+// compiled from: worst output difference, latency and code size.
+//
+// usage: bench <model.rwm> <generated object> <iterations>
+
+long fileSize(const std::string& fileName) {
+    std::ifstream file(fileName, std::ios::binary | std::ios::ate);
+    return long(file.tellg());
+}
+
+template<typename F>
+double latency(const std::vector<std::vector<double>>& inputs, const int& iterations, F&& function) {
+    auto start = std::chrono::steady_clock::now();
+    for(int i=0; i<iterations; ++i) {
+        function(inputs[i % inputs.size()]);
+    }
+    std::chrono::duration<double, std::micro> elapsed = std::chrono::steady_clock::now() - start;
+    return elapsed.count() / iterations;
+}
+
+int main(int argc, char* argv[]) {
+    if(argc != 4) {
+        std::cout << "usage: bench <model.rwm> <generated object> <iterations>\n";
+        return -1;
+    }
+    const std::string modelFile = argv[1];
+    const std::string objectFile = argv[2];
+    const int iterations = atoi(argv[3]);
+
+    DNN neural(DnnModel::loadModel(modelFile));
+
+    std::mt19937 generator(42);
+    std::uniform_real_distribution<double> pixel(0.0, 1.0);
+    std::vector<std::vector<double>> inputs(64, std::vector<double>(model::inputs));
+    for(auto& input: inputs) {
+        for(auto& value: input) {
+            value = pixel(generator);
+        }
+    }
+
+    double difference = 0;
+    double output[model::outputs];
+    for(const auto& input: inputs) {
+        const auto& reference = neural.query(input);
+        model::predict(input.data(), output);
+        for(int i=0; i<model::outputs; ++i) {
+            difference = std::max(difference, std::abs(reference[i][0] - output[i]));
+        }
+    }
+
+    volatile double sink = 0;
+    const double generic = latency(inputs, iterations, [&](const std::vector<double>& input) {
+        sink = neural.query(input)[0][0];
+    });
+    const double generated = latency(inputs, iterations, [&](const std::vector<double>& input) {
+        model::predict(input.data(), output);
+        sink = output[0];
+    });
+
+    std::cout << std::fixed << std::setprecision(2);
+    std::cout << "max difference: " << std::scientific << difference << std::fixed << '\n';
+    std::cout << "DNN::query:     " << generic << "us/query, " << fileSize(modelFile) << " bytes model file\n";
+    std::cout << "model::predict: " << generated << "us/query (x" << generic / generated << "), "
+              << fileSize(objectFile) << " bytes object\n";
+    return 0;
+}
@@ -0,0 +1,385 @@
+#ifndef AUGMENTATION_HPP
+#define AUGMENTATION_HPP
+
+#include "mnist.hpp"
+#include "matrixView.hpp"
+#include <vector>
+#include <deque>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <random>
+#include <chrono>
+#include <algorithm>
+#include <numeric>
+#include <cmath>
+#include <stdexcept>
+#if defined(__x86_64__)
+#include <immintrin.h>
+#endif
+
+// Ranges of the random transforms. Every draw is uniform in [-x, x].
+struct Augmentation {
+    double shift = 2.0;         // translation in pixels, sub-pixel
+    double rotation = 0.15;     // rotation about the centre in radians
+    double elasticAlpha = 20.0; // elastic displacement scale in pixels
+    double elasticSigma = 4.0;  // smoothing of the displacement field
+    double noise = 0.05;        // additive pixel noise
+};
+
+// Random distortions of a 28x28 MNIST sample in the loaders' [0.01, 1.0]
+// scale. Shift, rotation and an elastic displacement field (uniform noise
+// smoothed by a gaussian, Simard et al.) are folded into one source
+// coordinate per output pixel, sampled bilinearly, and noise is added on
+// top. The image is padded with zeros so sampling has no edge branches.
+//
+// The warp and the blur have AVX2 versions, eight pixels per step with
+// gathers for the bilinear taps, used when the CPU has them; the loops
+// they replace are kept for other machines.
+class Augmenter {
+public:
+    static constexpr int side = 28;
+    static constexpr int pixels = side * side;
+    static constexpr int maxRadius = side;
+
+    Augmenter(const Augmentation& params = Augmentation())
+    :   m_params(params),
+        m_radius(std::min<int>(std::ceil(2 * params.elasticSigma), maxRadius)) {
+
+        double total = 0;
+        for(int t=-m_radius; t<=m_radius; ++t) {
+            m_kernel.push_back(std::exp(-t*t / (2 * params.elasticSigma * params.elasticSigma)));
+            total += m_kernel.back();
+        }
+        for(auto& tap: m_kernel) {
+            tap /= total;
+        }
+
+        const float centre = (side - 1) / 2.0f;
+        for(int i=0; i<pixels; ++i) {
+            m_u[i] = i % side - centre;
+            m_v[i] = i / side - centre;
+        }
+    }
+
+    // out[pixels] = a random distortion of in[pixels].
+    template<typename Generator>
+    void apply(const double* in, double* out, Generator& generator) const {
+        float image[stride * stride] = {};
+        for(int y=0; y<side; ++y) {
+            for(int x=0; x<side; ++x) {
+                image[(y + pad)*stride + x + pad] = in[y*side + x] - 0.01f;
+            }
+        }
+
+        float dx[pixels] = {}, dy[pixels] = {};
+        if(m_params.elasticAlpha > 0) {
+            uniform(dx, pixels, 1.0f, generator);
+            uniform(dy, pixels, 1.0f, generator);
+            smooth(dx, m_params.elasticAlpha);
+            smooth(dy, m_params.elasticAlpha);
+        }
+
+        std::uniform_real_distribution<float> unit(-1.0f, 1.0f);
+        const float theta = m_params.rotation * unit(generator);
+        const float tx = m_params.shift * unit(generator);
+        const float ty = m_params.shift * unit(generator);
+
+        float noise[pixels];
+        uniform(noise, pixels, m_params.noise, generator);
+
+#if defined(__x86_64__)
+        if(simd()) {
+            warpSimd(image, dx, dy, noise, std::cos(theta), std::sin(theta), tx, ty, out);
+            return;
+        }
+#endif
+        warp(image, dx, dy, noise, std::cos(theta), std::sin(theta), tx, ty, out);
+    }
+private:
+    static constexpr int pad = 2;
+    static constexpr int stride = side + 2*pad;
+
+    static bool simd() {
+#if defined(__x86_64__)
+        static const bool supported = __builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma");
+        return supported;
+#else
+        return false;
+#endif
+    }
+
+    static float clamp(const float value, const float low, const float high) {
+        const float raised = (value < low)? low: value;
+        return (raised > high)? high: raised;
+    }
+
+    // Output pixel i reads the source at R(-theta) (u, v) + centre - shift
+    // + displacement, clamped into the zero border, then gets its noise.
+    void warp(const float* image, const float* dx, const float* dy, const float* noise,
+              const float& c, const float& s, const float& tx, const float& ty, double* out) const {
+        const float centre = (side - 1) / 2.0f;
+        for(int i=0; i<pixels; ++i) {
+            const float sx = clamp(c*m_u[i] + s*m_v[i] + centre - tx + dx[i], -1.5f, side + 0.5f) + pad;
+            const float sy = clamp(-s*m_u[i] + c*m_v[i] + centre - ty + dy[i], -1.5f, side + 0.5f) + pad;
+            const int ix = int(sx), iy = int(sy);
+            const float fx = sx - ix, fy = sy - iy;
+            const float* p = image + iy*stride + ix;
+            const float top = p[0] + fx * (p[1] - p[0]);
+            const float bottom = p[stride] + fx * (p[stride + 1] - p[stride]);
+            out[i] = clamp(top + fy * (bottom - top) + noise[i] + 0.01f, 0.01f, 1.0f);
+        }
+    }
+
+#if defined(__x86_64__)
+    __attribute__((target("avx2,fma")))
+    void warpSimd(const float* image, const float* dx, const float* dy, const float* noise,
+                  const float& c, const float& s, const float& tx, const float& ty, double* out) const {
+        static_assert(pixels % 8 == 0 && stride == 32, "warpSimd assumes 28x28 images");
+        const float centre = (side - 1) / 2.0f;
+        const __m256 vc = _mm256_set1_ps(c), vs = _mm256_set1_ps(s), ns = _mm256_set1_ps(-s);
+        const __m256 ox = _mm256_set1_ps(centre - tx + pad), oy = _mm256_set1_ps(centre - ty + pad);
+        const __m256 low = _mm256_set1_ps(pad - 1.5f), high = _mm256_set1_ps(side + 0.5f + pad);
+        const __m256 floor = _mm256_set1_ps(0.01f), one = _mm256_set1_ps(1.0f);
+
+        for(int i=0; i<pixels; i+=8) {
+            const __m256 u = _mm256_loadu_ps(m_u + i), v = _mm256_loadu_ps(m_v + i);
+            __m256 sx = _mm256_fmadd_ps(vc, u, _mm256_fmadd_ps(vs, v, _mm256_add_ps(ox, _mm256_loadu_ps(dx + i))));
+            __m256 sy = _mm256_fmadd_ps(ns, u, _mm256_fmadd_ps(vc, v, _mm256_add_ps(oy, _mm256_loadu_ps(dy + i))));
+            sx = _mm256_min_ps(_mm256_max_ps(sx, low), high);
+            sy = _mm256_min_ps(_mm256_max_ps(sy, low), high);
+
+            const __m256i ix = _mm256_cvttps_epi32(sx), iy = _mm256_cvttps_epi32(sy);
+            const __m256 fx = _mm256_sub_ps(sx, _mm256_cvtepi32_ps(ix));
+            const __m256 fy = _mm256_sub_ps(sy, _mm256_cvtepi32_ps(iy));
+            const __m256i index = _mm256_add_epi32(_mm256_slli_epi32(iy, 5), ix);
+
+            const __m256 p00 = _mm256_i32gather_ps(image, index, 4);
+            const __m256 p01 = _mm256_i32gather_ps(image + 1, index, 4);
+            const __m256 p10 = _mm256_i32gather_ps(image + stride, index, 4);
+            const __m256 p11 = _mm256_i32gather_ps(image + stride + 1, index, 4);
+            const __m256 top = _mm256_fmadd_ps(fx, _mm256_sub_ps(p01, p00), p00);
+            const __m256 bottom = _mm256_fmadd_ps(fx, _mm256_sub_ps(p11, p10), p10);
+            __m256 value = _mm256_fmadd_ps(fy, _mm256_sub_ps(bottom, top), top);
+            value = _mm256_add_ps(value, _mm256_add_ps(_mm256_loadu_ps(noise + i), floor));
+            value = _mm256_min_ps(_mm256_max_ps(value, floor), one);
+
+            _mm256_storeu_pd(out + i, _mm256_cvtps_pd(_mm256_castps256_ps128(value)));
+            _mm256_storeu_pd(out + i + 4, _mm256_cvtps_pd(_mm256_extractf128_ps(value, 1)));
+        }
+    }
+#endif
+
+    // values[count] uniform in [-scale, scale]. The fields need thousands
+    // of draws per sample, so they come four at a time from an xorshift64*
+    // stream seeded by the caller's generator rather than from it directly.
+    template<typename Generator>
+    static void uniform(float* values, const int& count, const float& scale, Generator& generator) {
+        std::uint64_t state = (std::uint64_t(generator()) << 32 | generator()) | 1;
+        const float step = 2 * scale / 65535.0f;
+        for(int i=0; i<count; i+=4) {
+            state ^= state >> 12;
+            state ^= state << 25;
+            state ^= state >> 27;
+            const std::uint64_t bits = state * 0x2545f4914f6cdd1dull;
+            for(int j=0; j<4 && i+j<count; ++j) {
+                values[i+j] = ((bits >> (16*j)) & 0xffff) * step - scale;
+            }
+        }
+    }
+
+    // Separable gaussian blur of a side x side field with a zero border,
+    // scaled by alpha. Each pass blurs along rows and writes the result
+    // transposed, so the second pass blurs the columns and transposes back.
+    void smooth(float* field, const float& alpha) const {
+        float row[32 + 2*maxRadius] = {};
+        float blurred[32];
+        float scratch[pixels];
+
+        for(int pass=0; pass<2; ++pass) {
+            const float gain = pass? alpha: 1.0f;
+            for(int y=0; y<side; ++y) {
+                std::copy(field + y*side, field + (y+1)*side, row + m_radius);
+#if defined(__x86_64__)
+                if(simd()) {
+                    blurRowSimd(row, gain, blurred);
+                } else
+#endif
+                blurRow(row, gain, blurred);
+                for(int x=0; x<side; ++x) {
+                    scratch[x*side + y] = blurred[x];
+                }
+            }
+            std::copy(scratch, scratch + pixels, field);
+        }
+    }
+
+    void blurRow(const float* row, const float& gain, float* blurred) const {
+        for(int x=0; x<side; ++x) {
+            float sum = 0;
+            for(int t=0; t<m_kernel.size(); ++t) {
+                sum += m_kernel[t] * row[x + t];
+            }
+            blurred[x] = gain * sum;
+        }
+    }
+
+#if defined(__x86_64__)
+    // All 32 lanes of blurred; the caller only reads the first side.
+    __attribute__((target("avx2,fma")))
+    void blurRowSimd(const float* row, const float& gain, float* blurred) const {
+        __m256 sum[4] = { _mm256_setzero_ps(), _mm256_setzero_ps(), _mm256_setzero_ps(), _mm256_setzero_ps() };
+        for(int t=0; t<m_kernel.size(); ++t) {
+            const __m256 tap = _mm256_set1_ps(m_kernel[t]);
+            for(int j=0; j<4; ++j) {
+                sum[j] = _mm256_fmadd_ps(tap, _mm256_loadu_ps(row + t + 8*j), sum[j]);
+            }
+        }
+        const __m256 scale = _mm256_set1_ps(gain);
+        for(int j=0; j<4; ++j) {
+            _mm256_storeu_ps(blurred + 8*j, _mm256_mul_ps(sum[j], scale));
+        }
+    }
+#endif
+private:
+    Augmentation m_params;
+    int m_radius;
+    std::vector<float> m_kernel;
+    float m_u[pixels];
+    float m_v[pixels];
+};
+
+// Feeds a training loop with freshly augmented samples. Worker threads
+// walk a shuffled order of the source rows, reshuffled on every pass,
+// distort each one and queue it; the loop takes them with next(). Buffers
+// cycle between the consumer and the workers, so nothing is allocated once
+// the queue is full. The source must outlive the pipeline.
+class AugmentationPipeline {
+public:
+    AugmentationPipeline(const ConstMatrixView<double>& samples, const std::vector<int>& labels, const Augmentation& params = Augmentation(),
+                         const int& workers = std::max(1u, std::thread::hardware_concurrency() / 2), const std::size_t& capacity = 256)
+    :   m_samples(samples),
+        m_labels(labels),
+        m_augmenter(params),
+        m_capacity(capacity),
+        m_order(samples.getRows()),
+        m_shuffler(std::chrono::system_clock::now().time_since_epoch().count()) {
+
+        if(samples.getCols() != Augmenter::pixels || labels.size() < samples.getRows()) {
+            throw std::length_error("augmentation needs one label per 28x28 sample");
+        }
+        if(samples.getRows() == 0 || workers < 1) {
+            throw std::invalid_argument("augmentation needs atleast one sample and one worker");
+        }
+
+        const auto seed = m_shuffler();
+        std::iota(m_order.begin(), m_order.end(), 0);
+        std::shuffle(m_order.begin(), m_order.end(), m_shuffler);
+        for(int w=0; w<workers; ++w) {
+            m_workers.emplace_back(&AugmentationPipeline::run, this, seed + w + 1);
+        }
+    }
+
+    AugmentationPipeline(const AugmentationPipeline&) = delete;
+    AugmentationPipeline& operator=(const AugmentationPipeline&) = delete;
+
+    ~AugmentationPipeline() {
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_stop = true;
+        }
+        m_space.notify_all();
+        for(auto& worker: m_workers) {
+            worker.join();
+        }
+    }
+
+    // Replaces data with the next augmented sample, waiting if none is
+    // ready. The old pixel buffer is handed back to the workers.
+    void next(MnistData& data) {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        if(m_ready.empty()) {
+            const auto start = std::chrono::steady_clock::now();
+            m_available.wait(lock, [this] { return !m_ready.empty(); });
+            m_stalled += std::chrono::steady_clock::now() - start;
+        }
+        std::swap(data, m_ready.front());
+        if(m_ready.front().pixels.capacity()) {
+            m_free.push_back(std::move(m_ready.front().pixels));
+        }
+        m_ready.pop_front();
+        lock.unlock();
+        m_space.notify_one();
+    }
+
+    // Time next() spent waiting for the workers.
+    double getStallSeconds() const {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        return m_stalled.count();
+    }
+
+    long getProduced() const {
+        return m_produced.load();
+    }
+private:
+    void run(const unsigned long& seed) {
+        std::mt19937 generator(seed);
+        MnistData data;
+        for(;;) {
+            int row;
+            {
+                // The slot is reserved here, so samples still being
+                // distorted count against the capacity.
+                std::unique_lock<std::mutex> lock(m_mutex);
+                m_space.wait(lock, [this] { return m_stop || m_ready.size() + m_pending < m_capacity; });
+                if(m_stop) {
+                    return;
+                }
+                ++m_pending;
+                if(!m_free.empty()) {
+                    data.pixels = std::move(m_free.back());
+                    m_free.pop_back();
+                }
+                if(m_next == m_order.size()) {
+                    std::shuffle(m_order.begin(), m_order.end(), m_shuffler);
+                    m_next = 0;
+                }
+                row = m_order[m_next++];
+            }
+
+            data.label = m_labels[row];
+            data.pixels.resize(Augmenter::pixels);
+            m_augmenter.apply(m_samples.row(row).data(), data.pixels.data(), generator);
+            ++m_produced;
+
+            {
+                std::lock_guard<std::mutex> lock(m_mutex);
+                m_ready.push_back(std::move(data));
+                --m_pending;
+            }
+            m_available.notify_one();
+        }
+    }
+private:
+    ConstMatrixView<double> m_samples;
+    const std::vector<int>& m_labels;
+    Augmenter m_augmenter;
+    std::size_t m_capacity;
+    std::vector<int> m_order;
+    std::mt19937 m_shuffler;
+    std::size_t m_next = 0;
+    std::size_t m_pending = 0;
+    std::atomic<long> m_produced{0};
+
+    std::deque<MnistData> m_ready;
+    std::vector<std::vector<double>> m_free;
+    std::chrono::duration<double> m_stalled{0};
+    bool m_stop = false;
+    mutable std::mutex m_mutex;
+    std::condition_variable m_available;
+    std::condition_variable m_space;
+    std::vector<std::thread> m_workers;
+};
+
+#endif
@@ -0,0 +1,215 @@
+#ifndef CASCADE_HPP
+#define CASCADE_HPP
+
+#include "matrixView.hpp"
+#include "inferenceSession.hpp"
+#include "halfDnn.hpp"
+#include "sparseDnn.hpp"
+#include "lowRankDnn.hpp"
+#include <vector>
+#include <string>
+#include <memory>
+#include <functional>
+#include <algorithm>
+#include <numeric>
+#include <limits>
+#include <stdexcept>
+
+// Answers a query with the cheapest of several models that is confident
+// enough. Stages run from cheapest to most expensive; a stage answers when
+// its margin, top class minus runner up, reaches its threshold, otherwise
+// the query escalates to the next stage. The last stage always answers.
+// Every stage reads the caller's input view, so escalating repeats only
+// the forward pass, never the loading or scaling of the sample.
+class Cascade {
+public:
+    // Takes an (inputs x 1) view and returns (outputs x 1), valid until the
+    // model is queried again.
+    using Model = std::function<ConstMatrixView<double>(const ConstMatrixView<double>&)>;
+
+    struct Result {
+        int label;
+        int stage;
+        double margin;
+    };
+
+    // Picks the network type from the file extension: rwm/ftm dense,
+    // rbm/rhm 16 bit, rsm pruned and rlm factorized.
+    static Model load(const std::string& fileName) {
+        const auto extension = fileName.substr(fileName.find_last_of('.') + 1);
+        if(extension == "rwm" || extension == "ftm") {
+            auto session = std::make_shared<InferenceSession>(DnnModel::loadModel(fileName));
+            auto context = std::make_shared<InferenceSession::Context>();
+            return [session, context](const ConstMatrixView<double>& input) { return session->query(*context, input); };
+        }
+        if(extension == bfloat16::extension) {
+            auto net = std::make_shared<HalfDNN<bfloat16>>(HalfDnnModel<bfloat16>::loadModel(fileName));
+            return [net](const ConstMatrixView<double>& input) { return ConstMatrixView<double>(net->query(input)); };
+        }
+        if(extension == float16::extension) {
+            auto net = std::make_shared<HalfDNN<float16>>(HalfDnnModel<float16>::loadModel(fileName));
+            return [net](const ConstMatrixView<double>& input) { return ConstMatrixView<double>(net->query(input)); };
+        }
+        if(extension == "rsm") {
+            // SparseDNN only takes a Vertex, so this stage copies its input.
+            const auto model = SparseDnnModel::loadModel(fileName);
+            auto net = std::make_shared<SparseDNN>(model);
+            auto vertex = std::make_shared<Vertex<double>>(model.m_weights.front().getCols());
+            return [net, vertex](const ConstMatrixView<double>& input) {
+                for(int i=0; i<vertex->getRows(); ++i) {
+                    (*vertex)[i][0] = input(i, 0);
+                }
+                return ConstMatrixView<double>(net->query(*vertex));
+            };
+        }
+        if(extension == "rlm") {
+            auto net = std::make_shared<LowRankDNN>(LowRankDnnModel::loadModel(fileName));
+            return [net](const ConstMatrixView<double>& input) { return ConstMatrixView<double>(net->query(input)); };
+        }
+        throw std::invalid_argument(extension + ": no file format for extension");
+    }
+
+    // Top class of an (outputs x 1) result and its lead over the next one.
+    static double margin(const ConstMatrixView<double>& output, int& label) {
+        double first = -std::numeric_limits<double>::infinity(), second = first;
+        label = 0;
+        for(int i=0; i<output.getRows(); ++i) {
+            const double value = output(i, 0);
+            if(value > first) {
+                second = first;
+                first = value;
+                label = i;
+            } else if(value > second) {
+                second = value;
+            }
+        }
+        return (output.getRows() > 1)? first - second: first;
+    }
+
+    // Stages are added cheapest first. A threshold of infinity always
+    // escalates; the last stage's threshold is ignored.
+    void add(const std::string& name, const Model& model, const double& threshold = 0) {
+        m_stages.push_back({name, model, threshold, 0});
+    }
+
+    Result query(const ConstMatrixView<double>& input) {
+        if(m_stages.empty()) {
+            throw std::length_error("cascade needs atleast one model");
+        }
+        Result result;
+        for(int s=0; s<m_stages.size(); ++s) {
+            auto& stage = m_stages[s];
+            result.margin = margin(stage.model(input), result.label);
+            if(s+1 == m_stages.size() || result.margin >= stage.threshold) {
+                result.stage = s;
+                ++stage.answered;
+                return result;
+            }
+        }
+        return result;
+    }
+
+    // Chooses thresholds on labelled samples, (inputs x count), so that the
+    // cascade keeps atleast target percent accuracy on them while answering
+    // as early as possible. Stages are fixed from the first: each accepts
+    // the largest set of its most confident samples for which the cascade
+    // still meets the target when everything else goes to the last stage.
+    // If the last stage alone misses the target, everything escalates.
+    // Returns the cascade's accuracy on the samples.
+    double calibrate(const ConstMatrixView<double>& samples, const std::vector<int>& labels, const double& target) {
+        const int count = samples.getCols(), S = m_stages.size();
+        if(S == 0) {
+            throw std::length_error("cascade needs atleast one model");
+        }
+        if(labels.size() != count || count == 0) {
+            throw std::length_error("calibration needs one label per sample");
+        }
+
+        std::vector<std::vector<double>> margins(S, std::vector<double>(count));
+        std::vector<std::vector<bool>> correct(S, std::vector<bool>(count));
+        for(int s=0; s<S; ++s) {
+            for(int j=0; j<count; ++j) {
+                int label;
+                margins[s][j] = margin(m_stages[s].model(samples.column(j)), label);
+                correct[s][j] = (label == labels[j]);
+            }
+        }
+
+        const double needed = target * count / 100.0 - 1e-9;
+        std::vector<int> remaining(count);
+        std::iota(remaining.begin(), remaining.end(), 0);
+        long answered = 0;
+        for(int s=0; s+1<S; ++s) {
+            const auto& confidence = margins[s];
+            std::sort(remaining.begin(), remaining.end(), [&](const int& a, const int& b) { return confidence[a] > confidence[b]; });
+
+            long last = 0;
+            for(const auto& j: remaining) {
+                last += correct[S-1][j];
+            }
+
+            int accepted = 0;
+            long here = 0;
+            for(int k=1; k<=remaining.size(); ++k) {
+                const int j = remaining[k-1];
+                here += correct[s][j];
+                last -= correct[S-1][j];
+                // Samples with equal margins go the same way.
+                if(k < remaining.size() && confidence[remaining[k]] == confidence[j]) {
+                    continue;
+                }
+                if(answered + here + last >= needed) {
+                    accepted = k;
+                }
+            }
+
+            m_stages[s].threshold = accepted? confidence[remaining[accepted-1]]: std::numeric_limits<double>::infinity();
+            for(int k=0; k<accepted; ++k) {
+                answered += correct[s][remaining[k]];
+            }
+            remaining.erase(remaining.begin(), remaining.begin() + accepted);
+        }
+        for(const auto& j: remaining) {
+            answered += correct[S-1][j];
+        }
+        return 100.0 * answered / count;
+    }
+
+    int getStages() const {
+        return m_stages.size();
+    }
+
+    const std::string& getName(const int& stage) const {
+        return m_stages[stage].name;
+    }
+
+    const double& getThreshold(const int& stage) const {
+        return m_stages[stage].threshold;
+    }
+
+    void setThreshold(const int& stage, const double& threshold) {
+        m_stages[stage].threshold = threshold;
+    }
+
+    // Queries answered by a stage since the last reset.
+    const long& getAnswered(const int& stage) const {
+        return m_stages[stage].answered;
+    }
+
+    void resetCounts() {
+        for(auto& stage: m_stages) {
+            stage.answered = 0;
+        }
+    }
+private:
+    struct Stage {
+        std::string name;
+        Model model;
+        double threshold;
+        long answered;
+    };
+
+    std::vector<Stage> m_stages;
+};
+
+#endif
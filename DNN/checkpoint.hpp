@@ -0,0 +1,142 @@
+#ifndef CHECKPOINT_HPP
+#define CHECKPOINT_HPP
+
+#include "dnn.hpp"
+#include "dnnModel.hpp"
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <fstream>
+#include <cstdio>
+#include <fcntl.h>
+#include <unistd.h>
+
+struct TrainingState {
+    int epoch;
+    int sample;
+    std::streamoff offset;
+};
+
+// Writes checkpoints from a background thread. The training thread only
+// copies the weights into whichever of the two snapshot buffers the writer
+// is not currently serializing, so a slow disk never stalls training.
+class Checkpointer {
+public:
+    Checkpointer(const std::string& fileName)
+    :   m_fileName(fileName),
+        m_writer(&Checkpointer::run, this) {}
+
+    Checkpointer(const Checkpointer&) = delete;
+    Checkpointer& operator=(const Checkpointer&) = delete;
+
+    ~Checkpointer() {
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_stop = true;
+        }
+        m_condition.notify_one();
+        m_writer.join();
+    }
+
+    void save(const DNN& neural, const TrainingState& state) {
+        int target;
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            target = (m_writing == 0)? 1: 0;
+            if(m_pending == target) {
+                m_pending = -1;
+            }
+        }
+
+        neural.snapshot(m_slots[target].model);
+        m_slots[target].state = state;
+
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_pending = target;
+        }
+        m_condition.notify_one();
+    }
+
+    void wait() {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        m_idle.wait(lock, [this] { return m_pending == -1 && m_writing == -1; });
+    }
+
+    static bool resume(const std::string& fileName, DnnModel& model, TrainingState& state) {
+        std::ifstream file(fileName, std::ios::binary);
+        if(!file.is_open()) {
+            return false;
+        }
+        file.exceptions(std::ios::failbit | std::ios::badbit);
+
+        file.read((char*)&state.epoch, sizeof(state.epoch));
+        file.read((char*)&state.sample, sizeof(state.sample));
+        file.read((char*)&state.offset, sizeof(state.offset));
+        model = DnnModel::read(file);
+        return true;
+    }
+private:
+    struct Slot {
+        DnnModel model;
+        TrainingState state;
+    };
+
+    void run() {
+        for(;;) {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            m_condition.wait(lock, [this] { return m_stop || m_pending != -1; });
+            if(m_pending == -1) {
+                return;
+            }
+            m_writing = m_pending;
+            m_pending = -1;
+            lock.unlock();
+
+            try {
+                write(m_slots[m_writing]);
+            } catch(const std::exception& e) {
+                std::cerr << "checkpoint: " << e.what() << '\n';
+            }
+
+            lock.lock();
+            m_writing = -1;
+            lock.unlock();
+            m_idle.notify_all();
+        }
+    }
+
+    void write(const Slot& slot) const {
+        auto temporary = m_fileName + ".tmp";
+        {
+            std::ofstream file(temporary, std::ios::binary);
+            file.exceptions(std::ios::failbit | std::ios::badbit);
+
+            file.write((char*)&slot.state.epoch, sizeof(slot.state.epoch));
+            file.write((char*)&slot.state.sample, sizeof(slot.state.sample));
+            file.write((char*)&slot.state.offset, sizeof(slot.state.offset));
+            slot.model.write(file);
+        }
+
+        int fd = ::open(temporary.c_str(), O_RDONLY);
+        if(fd != -1) {
+            ::fsync(fd);
+            ::close(fd);
+        }
+        if(std::rename(temporary.c_str(), m_fileName.c_str()) != 0) {
+            std::cerr << "checkpoint: could not replace " << m_fileName << '\n';
+        }
+    }
+private:
+    std::string m_fileName;
+    Slot m_slots[2];
+    int m_pending = -1;
+    int m_writing = -1;
+    bool m_stop = false;
+    std::mutex m_mutex;
+    std::condition_variable m_condition;
+    std::condition_variable m_idle;
+    std::thread m_writer;
+};
+
+#endif
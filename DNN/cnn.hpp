@@ -0,0 +1,75 @@
+#ifndef CNN_HPP
+#define CNN_HPP
+
+#include "layer.hpp"
+#include "cnnModel.hpp"
+#include <vector>
+#include <memory>
+#include <cmath>
+
+class CNN {
+public:
+    CNN(const std::vector<LayerSpec>& topology, const double& learningRate = 0.1)
+    :   m_learningRate(learningRate) {
+
+        if(topology.empty()) {
+            throw std::length_error("Network needs atleast one layer.");
+        }
+
+        for(const auto& spec: topology) {
+            m_layers.push_back(makeLayer(spec));
+        }
+    }
+
+    CNN(const CnnModel& model)
+    :   CNN(model.m_layers, model.m_learningRate) {}
+
+    void setLearningRate(const double& lr) {
+        m_learningRate = lr;
+    }
+
+    double getError() const {
+        double error = 0;
+        for(int i=0; i<m_error.getRows(); ++i) {
+            error += m_error[i][0] * m_error[i][0];
+        }
+        return sqrt(error/m_error.getRows());
+    }
+
+    void train(const Vertex<double>& input_list, const Vertex<double>& target_list) {
+        query(input_list);
+
+        m_error = target_list - m_layers.back()->getOutput();
+        auto error = m_error;
+        for(int i=m_layers.size()-1; i>=1; --i) {
+            error = m_layers[i]->backward(m_layers[i-1]->getOutput(), error, m_learningRate);
+        }
+        m_layers[0]->backward(input_list, error, m_learningRate);
+    }
+
+    const Matrix<double>& query(const Vertex<double>& input_list) {
+        const Matrix<double>* output = &m_layers[0]->forward(input_list);
+        for(int i=1; i<m_layers.size(); ++i) {
+            output = &m_layers[i]->forward(*output);
+        }
+        return *output;
+    }
+
+    CnnModel getModel() const {
+        CnnModel model{m_learningRate, {}};
+        for(const auto& layer: m_layers) {
+            model.m_layers.push_back(layer->getSpec());
+        }
+        return model;
+    }
+
+    void saveModel(const std::string& fileName) const {
+        getModel().saveModel(fileName);
+    }
+private:
+    double m_learningRate;
+    Matrix<double> m_error;
+    std::vector<std::unique_ptr<Layer>> m_layers;
+};
+
+#endif
@@ -0,0 +1,116 @@
+#ifndef CNN_MODEL_HPP
+#define CNN_MODEL_HPP
+
+#include "matrix.hpp"
+#include <vector>
+#include <fstream>
+#include <stdexcept>
+
+enum class LayerType : int {
+    Dense,
+    Conv2D,
+    MaxPool2D
+};
+
+// Input geometry is channels x height x width. Dense layers use channels
+// as their input count, outputs is the number of neurons or output
+// channels and kernel is the convolution kernel or pooling window size.
+struct LayerSpec {
+    LayerType type;
+    int channels, height, width;
+    int outputs;
+    int kernel, stride, padding;
+    Matrix<double> weights;
+
+    static LayerSpec dense(const int& inputs, const int& outputs) {
+        return { LayerType::Dense, inputs, 1, 1, outputs, 0, 0, 0, Matrix<double>(0, 0) };
+    }
+
+    static LayerSpec conv2D(const int& channels, const int& height, const int& width, const int& outputs,
+                            const int& kernel, const int& stride = 1, const int& padding = 0) {
+        return { LayerType::Conv2D, channels, height, width, outputs, kernel, stride, padding, Matrix<double>(0, 0) };
+    }
+
+    static LayerSpec maxPool2D(const int& channels, const int& height, const int& width, const int& size) {
+        return { LayerType::MaxPool2D, channels, height, width, channels, size, size, 0, Matrix<double>(0, 0) };
+    }
+
+    bool hasWeights() const {
+        return type != LayerType::MaxPool2D;
+    }
+};
+
+struct CnnModel {
+
+    void saveModel(const std::string& fileName) const {
+        auto index = fileName.find_last_of('.');
+        auto extension = fileName.substr(index+1);
+        if(extension == "rcm") {
+            saveRawModel(fileName);
+        } else {
+            throw std::invalid_argument(extension + ": no file format for extension");
+        }
+    }
+
+    static auto loadModel(const std::string& fileName) {
+        auto index = fileName.find_last_of('.');
+        auto extension = fileName.substr(index+1);
+        if(extension == "rcm") {
+            return loadRawModel(fileName);
+        } else {
+            throw std::invalid_argument(extension + ": no file format for extension");
+        }
+    }
+
+private:
+    void saveRawModel(const std::string& fileName) const {
+        std::ofstream file(fileName, std::ios::binary);
+        file.exceptions(std::ios::failbit | std::ios::badbit);
+
+        file.write((char*)&m_learningRate, sizeof(m_learningRate));
+        int size = m_layers.size();
+        file.write((char*)&size, sizeof(size));
+
+        for(const auto& layer: m_layers) {
+            int header[] = { int(layer.type), layer.channels, layer.height, layer.width,
+                             layer.outputs, layer.kernel, layer.stride, layer.padding };
+            file.write((char*)header, sizeof(header));
+            if(layer.hasWeights()) {
+                file.write((char*)&layer.weights.getRows(), sizeof(layer.weights.getRows()));
+                file.write((char*)&layer.weights.getCols(), sizeof(layer.weights.getCols()));
+                file.write((char*)layer.weights.data(), sizeof(double) * layer.weights.getRows() * layer.weights.getCols());
+            }
+        }
+    }
+
+    static CnnModel loadRawModel(const std::string& fileName) {
+        std::ifstream file(fileName, std::ios::binary);
+        file.exceptions(std::ios::failbit | std::ios::badbit);
+
+        CnnModel model;
+        file.read((char*)&model.m_learningRate, sizeof(model.m_learningRate));
+        int layerCount;
+        file.read((char*)&layerCount, sizeof(layerCount));
+
+        for(int i=0; i<layerCount; ++i) {
+            int header[8];
+            file.read((char*)header, sizeof(header));
+            LayerSpec layer{ LayerType(header[0]), header[1], header[2], header[3],
+                             header[4], header[5], header[6], header[7], Matrix<double>(0, 0) };
+            if(layer.hasWeights()) {
+                int rows, cols;
+                file.read((char*)&rows, sizeof(rows));
+                file.read((char*)&cols, sizeof(cols));
+                layer.weights = Matrix<double>(rows, cols);
+                file.read((char*)layer.weights.data(), sizeof(double) * rows * cols);
+            }
+            model.m_layers.push_back(layer);
+        }
+        return model;
+    }
+public:
+    double m_learningRate;
+    std::vector<LayerSpec> m_layers;
+};
+
+#endif
@@ -0,0 +1,130 @@
+#ifndef COMPILER_HPP
+#define COMPILER_HPP
+
+#include "dnnModel.hpp"
+#include <string>
+#include <fstream>
+#include <iomanip>
+#include <stdexcept>
+#include <cctype>
+
+// Turns a trained DnnModel into a standalone C++ header/source pair with
+// the weights baked in as constexpr arrays and every loop bound fixed at
+// compile time. The generated code only needs <cmath>, allocates nothing
+// and computes the same sigmoid network as DNN::query.
+//
+// Weights are emitted transposed (inputs x outputs) so each layer is a
+// sequence of axpy updates over a fixed length output row, which the
+// compiler unrolls and vectorizes without reassociating the sums.
+class Compiler {
+public:
+    Compiler(const DnnModel& model, const std::string& name)
+    :   m_model(model),
+        m_name(name) {
+
+        if(model.m_weights.empty()) {
+            throw std::length_error("Network needs atleast two layers.");
+        }
+        for(int i=1; i<model.m_weights.size(); ++i) {
+            if(model.m_weights[i].getCols() != model.m_weights[i-1].getRows()) {
+                throw std::length_error("mismatched layer sizes in model");
+            }
+        }
+        if(name.empty() || std::isdigit(name[0])) {
+            throw std::invalid_argument(name + ": not a valid C++ identifier");
+        }
+        for(auto c: name) {
+            if(!std::isalnum(c) && c != '_') {
+                throw std::invalid_argument(name + ": not a valid C++ identifier");
+            }
+        }
+    }
+
+    // Writes <prefix>.hpp and <prefix>.cpp.
+    void compile(const std::string& prefix) const {
+        const auto slash = prefix.find_last_of('/');
+        const auto headerName = prefix.substr(slash == std::string::npos? 0: slash+1) + ".hpp";
+
+        std::ofstream header(prefix + ".hpp");
+        std::ofstream source(prefix + ".cpp");
+        if(!header || !source) {
+            throw std::runtime_error(prefix + ": cannot write generated model");
+        }
+        writeHeader(header);
+        writeSource(source, headerName);
+    }
+
+    void writeHeader(std::ostream& out) const {
+        std::string guard;
+        for(auto c: m_name) {
+            guard += std::toupper(c);
+        }
+        guard += "_HPP";
+
+        out << "// Generated from a DnnModel. Do not edit.\n"
+            << "#ifndef " << guard << "\n#define " << guard << "\n\n"
+            << "namespace " << m_name << " {\n\n"
+            << "constexpr int inputs = " << m_model.m_weights.front().getCols() << ";\n"
+            << "constexpr int outputs = " << m_model.m_weights.back().getRows() << ";\n\n"
+            << "// output[outputs] = network(input[inputs])\n"
+            << "void predict(const double* input, double* output);\n\n"
+            << "}\n\n#endif\n";
+    }
+
+    void writeSource(std::ostream& out, const std::string& headerName) const {
+        const auto& weights = m_model.m_weights;
+
+        out << "// Generated from a DnnModel. Do not edit.\n"
+            << "#include \"" << headerName << "\"\n"
+            << "#include <cmath>\n\n"
+            << "namespace " << m_name << " {\n"
+            << "namespace {\n\n";
+
+        out << std::hexfloat;
+        for(int l=0; l<weights.size(); ++l) {
+            const auto& weight = weights[l];
+            out << "alignas(64) constexpr double w" << l << "[" << weight.getCols() << "][" << weight.getRows() << "] = {\n";
+            for(int j=0; j<weight.getCols(); ++j) {
+                out << "    {";
+                for(int i=0; i<weight.getRows(); ++i) {
+                    out << (i % 4 == 0? "\n        ": " ") << weight[i][j] << ",";
+                }
+                out << "\n    },\n";
+            }
+            out << "};\n\n";
+        }
+        out << std::defaultfloat;
+
+        out << "template<int Inputs, int Outputs>\n"
+            << "inline void dense(const double (&w)[Inputs][Outputs], const double* __restrict in, double* __restrict out) {\n"
+            << "    alignas(64) double sum[Outputs] = {};\n"
+            << "    for(int j=0; j<Inputs; ++j) {\n"
+            << "        const double x = in[j];\n"
+            << "#pragma GCC unroll 4\n"
+            << "        for(int i=0; i<Outputs; ++i) {\n"
+            << "            sum[i] += w[j][i] * x;\n"
+            << "        }\n"
+            << "    }\n"
+            << "    for(int i=0; i<Outputs; ++i) {\n"
+            << "        out[i] = 1.0 / (1.0 + std::exp(-sum[i]));\n"
+            << "    }\n"
+            << "}\n\n"
+            << "}\n\n";
+
+        out << "void predict(const double* input, double* output) {\n";
+        for(int l=0; l+1<weights.size(); ++l) {
+            out << "    alignas(64) double a" << l << "[" << weights[l].getRows() << "];\n";
+        }
+        for(int l=0; l<weights.size(); ++l) {
+            const std::string in = (l == 0)? "input": "a" + std::to_string(l-1);
+            const std::string result = (l+1 == weights.size())? "output": "a" + std::to_string(l);
+            out << "    dense(w" << l << ", " << in << ", " << result << ");\n";
+        }
+        out << "}\n\n}\n";
+    }
+private:
+    DnnModel m_model;
+    std::string m_name;
+};
+
+#endif
@@ -0,0 +1,174 @@
+#ifndef CSV_DATASET_HPP
+#define CSV_DATASET_HPP
+
+#include "matrixView.hpp"
+#include "scheduler.hpp"
+#include <vector>
+#include <array>
+#include <string>
+#include <charconv>
+#include <memory>
+#include <algorithm>
+#include <stdexcept>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+// Parses one "label,f0,f1,..." record into label and features[count],
+// scaling every feature from [0, 255] to [0.01, 1.0] like the rest of the
+// MNIST loaders. Returns false if the record is malformed or short.
+inline bool parseCsvRecord(const char* first, const char* last, int& label, double* features, const int& count) {
+    static const auto scaled = [] {
+        std::array<double, 256> table;
+        for(int i=0; i<256; ++i) {
+            table[i] = (i/255.0 * 0.99) + 0.01;
+        }
+        return table;
+    }();
+
+    auto next = [&](int& value) {
+        while(first != last && (*first == ' ' || *first == ',')) {
+            ++first;
+        }
+        auto result = std::from_chars(first, last, value);
+        first = result.ptr;
+        return result.ec == std::errc();
+    };
+
+    if(!next(label)) {
+        return false;
+    }
+    int value;
+    for(int i=0; i<count; ++i) {
+        if(!next(value)) {
+            return false;
+        }
+        features[i] = (unsigned(value) < 256)? scaled[value]: (value/255.0 * 0.99) + 0.01;
+    }
+    return true;
+}
+
+// Loads a whole MNIST style CSV file into one contiguous (rows x features)
+// buffer. The file is read with a few large read() calls, cut into ranges
+// at line boundaries, and the ranges are counted and then parsed in
+// parallel straight into their final rows, so nothing is allocated per
+// sample. A header line that does not start with a digit is skipped.
+class CsvDataset {
+public:
+    CsvDataset(const std::string& fileName, const int& features = 784)
+    :   m_features(features) {
+
+        std::size_t size;
+        const auto text = readFile(fileName, size);
+        const char* begin = text.get();
+        const char* end = text.get() + size;
+        if(begin != end && (*begin < '0' || *begin > '9')) {
+            begin = std::find(begin, end, '\n');
+            begin += (begin != end);
+        }
+
+        const int chunks = std::max<long>(1, std::min<long>(Scheduler::instance().getConcurrency() * 4, (end - begin) >> 16));
+        std::vector<const char*> bounds(chunks + 1, end);
+        bounds[0] = begin;
+        for(int i=1; i<chunks; ++i) {
+            auto split = std::max(bounds[i-1], begin + (end - begin) * i / chunks);
+            split = std::find(split, end, '\n');
+            bounds[i] = split + (split != end);
+        }
+
+        std::vector<int> rows(chunks + 1, 0);
+        parallel_for(0, chunks, 1, [&](const int& first, const int& last) {
+            for(int c=first; c<last; ++c) {
+                forEachLine(bounds[c], bounds[c+1], [&](const char*, const char*) { ++rows[c+1]; });
+            }
+        });
+        for(int c=0; c<chunks; ++c) {
+            rows[c+1] += rows[c];
+        }
+
+        // Left uninitialised: every element is written exactly once below,
+        // and the first touch happens on the thread that parses the row.
+        m_labels.resize(rows[chunks]);
+        m_samples.reset(new double[std::size_t(rows[chunks]) * features]);
+        parallel_for(0, chunks, 1, [&](const int& first, const int& last) {
+            PROFILE_SCOPE("parse");
+            for(int c=first; c<last; ++c) {
+                int row = rows[c];
+                forEachLine(bounds[c], bounds[c+1], [&](const char* line, const char* lineEnd) {
+                    if(!parseCsvRecord(line, lineEnd, m_labels[row], m_samples.get() + std::size_t(row) * m_features, m_features)) {
+                        throw std::runtime_error(fileName + ": malformed record " + std::to_string(row + 1));
+                    }
+                    ++row;
+                });
+            }
+        });
+    }
+
+    int getRows() const {
+        return m_labels.size();
+    }
+
+    const int& getFeatures() const {
+        return m_features;
+    }
+
+    const std::vector<int>& getLabels() const {
+        return m_labels;
+    }
+
+    // One sample per row.
+    ConstMatrixView<double> getSamples() const {
+        return ConstMatrixView<double>(m_samples.get(), getRows(), m_features, m_features);
+    }
+
+    // Sample i as a (features x 1) column.
+    ConstMatrixView<double> getSample(const int& i) const {
+        return getSamples().row(i).transpose();
+    }
+private:
+    static std::unique_ptr<char[]> readFile(const std::string& fileName, std::size_t& size) {
+        int fd = ::open(fileName.c_str(), O_RDONLY);
+        if(fd == -1) {
+            throw std::invalid_argument(fileName + " not available");
+        }
+        struct stat status;
+        ::fstat(fd, &status);
+        ::posix_fadvise(fd, 0, 0, POSIX_FADV_SEQUENTIAL);
+
+        size = status.st_size;
+        std::unique_ptr<char[]> text(new char[size]);
+        std::size_t done = 0;
+        while(done < size) {
+            auto count = ::read(fd, text.get() + done, std::min<std::size_t>(size - done, 1 << 26));
+            if(count <= 0) {
+                ::close(fd);
+                throw std::runtime_error(fileName + ": read failed");
+            }
+            done += count;
+        }
+        ::close(fd);
+        return text;
+    }
+
+    // Calls function(first, last) for every non blank line in [begin, end).
+    template<typename F>
+    static void forEachLine(const char* begin, const char* end, F&& function) {
+        while(begin != end) {
+            auto newline = std::find(begin, end, '\n');
+            auto last = newline;
+            if(last != begin && last[-1] == '\r') {
+                --last;
+            }
+            if(last != begin) {
+                function(begin, last);
+            }
+            begin = newline + (newline != end);
+        }
+    }
+private:
+    int m_features;
+    std::vector<int> m_labels;
+    std::unique_ptr<double[]> m_samples;
+};
+
+#endif
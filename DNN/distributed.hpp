@@ -0,0 +1,351 @@
+#ifndef DISTRIBUTED_HPP
+#define DISTRIBUTED_HPP
+
+#include "matrix.hpp"
+#include <vector>
+#include <iostream>
+#include <chrono>
+#include <string>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <stdexcept>
+#include <cstring>
+#include <cerrno>
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <sys/wait.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <arpa/inet.h>
+#include <netdb.h>
+#include <poll.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+// Ring of TCP connections between ranks. Rank r listens on port + r and
+// connects to rank r+1 on nextHost, so every rank sends to its successor
+// and receives from its predecessor.
+class RingCommunicator {
+public:
+    RingCommunicator(const int& rank, const int& size, const std::string& nextHost = "127.0.0.1", const int& port = 29500)
+    :   m_rank(rank),
+        m_size(size) {
+
+        if(rank < 0 || rank >= size) {
+            throw std::invalid_argument("rank outside of the ring");
+        }
+        if(size == 1) {
+            return;
+        }
+
+        int listener = ::socket(AF_INET, SOCK_STREAM, 0);
+        int yes = 1;
+        ::setsockopt(listener, SOL_SOCKET, SO_REUSEADDR, &yes, sizeof(yes));
+        sockaddr_in address{};
+        address.sin_family = AF_INET;
+        address.sin_addr.s_addr = htonl(INADDR_ANY);
+        address.sin_port = htons(port + rank);
+        if(::bind(listener, (sockaddr*)&address, sizeof(address)) != 0 || ::listen(listener, 1) != 0) {
+            ::close(listener);
+            throw std::runtime_error("rank " + std::to_string(rank) + ": cannot listen on port " + std::to_string(port + rank));
+        }
+
+        m_next = connect(nextHost, port + (rank + 1) % size);
+        m_previous = ::accept(listener, nullptr, nullptr);
+        ::close(listener);
+        if(m_previous == -1) {
+            throw std::runtime_error("rank " + std::to_string(rank) + ": accept failed");
+        }
+
+        for(auto fd: { m_next, m_previous }) {
+            ::setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &yes, sizeof(yes));
+            ::fcntl(fd, F_SETFL, ::fcntl(fd, F_GETFL) | O_NONBLOCK);
+        }
+    }
+
+    RingCommunicator(const RingCommunicator&) = delete;
+    RingCommunicator& operator=(const RingCommunicator&) = delete;
+
+    ~RingCommunicator() {
+        if(m_next != -1) {
+            ::close(m_next);
+        }
+        if(m_previous != -1) {
+            ::close(m_previous);
+        }
+    }
+
+    const int& getRank() const {
+        return m_rank;
+    }
+
+    const int& getSize() const {
+        return m_size;
+    }
+
+    // Sums data across all ranks in place. Reduce-scatter followed by
+    // all-gather: every rank sends and receives 2(size-1)/size of the
+    // buffer, and each element is reduced on exactly one rank, so the
+    // result is bitwise identical everywhere.
+    void allReduce(double* data, const std::size_t& count) {
+        if(m_size == 1 || count == 0) {
+            return;
+        }
+
+        std::vector<std::size_t> offsets(m_size + 1);
+        for(int i=0; i<=m_size; ++i) {
+            offsets[i] = count * i / m_size;
+        }
+        std::vector<double> incoming(count / m_size + 1);
+
+        for(int step=0; step<m_size-1; ++step) {
+            const int send = (m_rank - step + m_size) % m_size;
+            const int receive = (m_rank - step - 1 + m_size) % m_size;
+            const std::size_t receiveCount = offsets[receive+1] - offsets[receive];
+            exchange(data + offsets[send], offsets[send+1] - offsets[send], incoming.data(), receiveCount);
+            for(std::size_t i=0; i<receiveCount; ++i) {
+                data[offsets[receive] + i] += incoming[i];
+            }
+        }
+
+        for(int step=0; step<m_size-1; ++step) {
+            const int send = (m_rank + 1 - step + m_size) % m_size;
+            const int receive = (m_rank - step + m_size) % m_size;
+            exchange(data + offsets[send], offsets[send+1] - offsets[send], data + offsets[receive], offsets[receive+1] - offsets[receive]);
+        }
+    }
+private:
+    static int connect(const std::string& host, const int& port) {
+        addrinfo hints{};
+        hints.ai_family = AF_INET;
+        hints.ai_socktype = SOCK_STREAM;
+        addrinfo* result;
+        if(::getaddrinfo(host.c_str(), std::to_string(port).c_str(), &hints, &result) != 0) {
+            throw std::invalid_argument(host + ": unknown host");
+        }
+
+        for(int attempt=0; attempt<600; ++attempt) {
+            int fd = ::socket(AF_INET, SOCK_STREAM, 0);
+            if(::connect(fd, result->ai_addr, result->ai_addrlen) == 0) {
+                ::freeaddrinfo(result);
+                return fd;
+            }
+            ::close(fd);
+            std::this_thread::sleep_for(std::chrono::milliseconds(50));
+        }
+        ::freeaddrinfo(result);
+        throw std::runtime_error(host + ":" + std::to_string(port) + ": connection refused");
+    }
+
+    void exchange(const double* send, const std::size_t& sendCount, double* receive, const std::size_t& receiveCount) {
+        auto out = (const char*)send;
+        auto in = (char*)receive;
+        std::size_t outLeft = sendCount * sizeof(double);
+        std::size_t inLeft = receiveCount * sizeof(double);
+
+        while(outLeft > 0 || inLeft > 0) {
+            // A finished direction is dropped from the poll (negative fds
+            // are ignored); a writable socket would otherwise wake it at
+            // once and spin until the other side is done.
+            pollfd fds[2] = { { outLeft > 0? m_next: -1, POLLOUT, 0 }, { inLeft > 0? m_previous: -1, POLLIN, 0 } };
+            ::poll(fds, 2, -1);
+
+            if(outLeft > 0 && (fds[0].revents & (POLLOUT | POLLERR))) {
+                auto written = ::send(m_next, out, outLeft, MSG_NOSIGNAL);
+                if(written < 0 && errno != EAGAIN) {
+                    throw std::runtime_error("ring: send failed: " + std::string(std::strerror(errno)));
+                }
+                if(written > 0) {
+                    out += written;
+                    outLeft -= written;
+                }
+            }
+            if(inLeft > 0 && (fds[1].revents & (POLLIN | POLLERR | POLLHUP))) {
+                auto read = ::recv(m_previous, in, inLeft, 0);
+                if(read == 0 || (read < 0 && errno != EAGAIN)) {
+                    throw std::runtime_error("ring: predecessor disconnected");
+                }
+                if(read > 0) {
+                    in += read;
+                    inLeft -= read;
+                }
+            }
+        }
+    }
+private:
+    int m_rank, m_size;
+    int m_next = -1;
+    int m_previous = -1;
+};
+
+// Groups layer gradients into buckets of roughly bucketBytes, in the order
+// backpropagation finishes them. A bucket is all-reduced on a background
+// thread as soon as its last layer is ready, so communication for the
+// upper layers overlaps with the backward pass of the lower ones.
+class GradientReducer {
+public:
+    GradientReducer(RingCommunicator& communicator, std::vector<Matrix<double>>& gradients, const std::size_t& bucketBytes = 1 << 18)
+    :   m_communicator(communicator),
+        m_gradients(gradients),
+        m_bucketOf(gradients.size()) {
+
+        std::size_t bytes = 0;
+        for(int i=gradients.size()-1; i>=0; --i) {
+            const std::size_t layerBytes = sizeof(double) * gradients[i].getRows() * gradients[i].getCols();
+            if(m_buckets.empty() || bytes + layerBytes > bucketBytes) {
+                m_buckets.push_back({});
+                bytes = 0;
+            }
+            m_buckets.back().layers.push_back(i);
+            m_bucketOf[i] = m_buckets.size() - 1;
+            bytes += layerBytes;
+        }
+        for(auto& bucket: m_buckets) {
+            std::size_t size = 0;
+            for(auto layer: bucket.layers) {
+                size += gradients[layer].getRows() * gradients[layer].getCols();
+            }
+            bucket.buffer.resize(size);
+        }
+
+        m_worker = std::thread(&GradientReducer::run, this);
+    }
+
+    GradientReducer(const GradientReducer&) = delete;
+    GradientReducer& operator=(const GradientReducer&) = delete;
+
+    ~GradientReducer() {
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_stop = true;
+        }
+        m_condition.notify_all();
+        m_worker.join();
+    }
+
+    int getBucketCount() const {
+        return m_buckets.size();
+    }
+
+    void ready(const int& layer) {
+        auto& bucket = m_buckets[m_bucketOf[layer]];
+        if(++bucket.ready < bucket.layers.size()) {
+            return;
+        }
+
+        std::size_t offset = 0;
+        for(auto l: bucket.layers) {
+            const auto& gradient = m_gradients[l];
+            std::copy(gradient.data(), gradient.data() + gradient.getRows()*gradient.getCols(), bucket.buffer.data() + offset);
+            offset += gradient.getRows() * gradient.getCols();
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_queue.push_back(m_bucketOf[layer]);
+            ++m_outstanding;
+        }
+        m_condition.notify_all();
+    }
+
+    void wait() {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        m_condition.wait(lock, [this] { return m_outstanding == 0; });
+        if(m_exception) {
+            auto exception = m_exception;
+            m_exception = nullptr;
+            std::rethrow_exception(exception);
+        }
+
+        for(auto& bucket: m_buckets) {
+            std::size_t offset = 0;
+            for(auto l: bucket.layers) {
+                auto& gradient = m_gradients[l];
+                std::copy(bucket.buffer.data() + offset, bucket.buffer.data() + offset + gradient.getRows()*gradient.getCols(), gradient.data());
+                offset += gradient.getRows() * gradient.getCols();
+            }
+            bucket.ready = 0;
+        }
+    }
+private:
+    struct Bucket {
+        std::vector<int> layers;
+        std::vector<double> buffer;
+        std::size_t ready = 0;
+    };
+
+    void run() {
+        for(;;) {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            m_condition.wait(lock, [this] { return m_stop || !m_queue.empty(); });
+            if(m_queue.empty()) {
+                return;
+            }
+            auto& bucket = m_buckets[m_queue.front()];
+            m_queue.pop_front();
+            lock.unlock();
+
+            try {
+                m_communicator.allReduce(bucket.buffer.data(), bucket.buffer.size());
+            } catch(...) {
+                lock.lock();
+                m_exception = std::current_exception();
+                lock.unlock();
+            }
+
+            lock.lock();
+            --m_outstanding;
+            lock.unlock();
+            m_condition.notify_all();
+        }
+    }
+private:
+    RingCommunicator& m_communicator;
+    std::vector<Matrix<double>>& m_gradients;
+    std::vector<Bucket> m_buckets;
+    std::vector<int> m_bucketOf;
+    std::deque<int> m_queue;
+    int m_outstanding = 0;
+    bool m_stop = false;
+    std::exception_ptr m_exception;
+    std::mutex m_mutex;
+    std::condition_variable m_condition;
+    std::thread m_worker;
+};
+
+// Forks one process per rank on this machine and waits for all of them.
+// Must run before anything starts threads, since fork() only copies the
+// calling thread.
+inline bool launch(const int& size, const std::function<int(const int&)>& worker) {
+    std::vector<pid_t> children;
+    for(int rank=0; rank<size; ++rank) {
+        pid_t pid = ::fork();
+        if(pid == 0) {
+            int status = 1;
+            try {
+                status = worker(rank);
+            } catch(const std::exception& e) {
+                std::cerr << "rank " << rank << ": " << e.what() << '\n';
+            }
+            std::cout.flush();
+            ::_exit(status);
+        }
+        if(pid < 0) {
+            throw std::runtime_error("fork failed");
+        }
+        children.push_back(pid);
+    }
+
+    bool success = true;
+    for(auto pid: children) {
+        int status;
+        ::waitpid(pid, &status, 0);
+        success = success && WIFEXITED(status) && WEXITSTATUS(status) == 0;
+    }
+    return success;
+}
+
+#endif
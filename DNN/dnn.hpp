@@ -2,6 +2,8 @@
 #define DNN_HPP
 
 #include "matrix.hpp"
+#include "matrixView.hpp"
+#include "activation.hpp"
 #include "dnnModel.hpp"
 #include <vector>
 #include <iostream>
@@ -9,6 +11,7 @@
 #include <random>
 #include <fstream>
 #include <exception>
+#include <functional>
 
 class DNN {
 private:
@@ -18,7 +21,8 @@ public:
     DNN(const std::vector<int>& topology, const double& learningRate = 0.1)
     :   m_learningRate(learningRate),
         m_weights(topology.size()-1),
-        m_outputs(m_weights.size()) {
+        m_outputs(m_weights.size()),
+        m_frozen(m_weights.size()) {
 
         if(topology.size() < 2) {
             throw std::length_error("Network needs atleast two layers.");
@@ -43,7 +47,8 @@ public:
     DNN(const DnnModel& model)
     :   m_learningRate(model.m_learningRate),
         m_weights(model.m_weights),
-        m_outputs(model.m_weights.size()) {}
+        m_outputs(model.m_weights.size()),
+        m_frozen(model.m_weights.size()) {}
 
     void setLearningRate(const double& lr) {
         m_learningRate = lr;
@@ -57,88 +62,174 @@ public:
         return sqrt(error/m_error.getRows());
     }
 
-    void train(const Vertex<double>& input_list, const Vertex<double>& target_list) {
+    void train(const ConstMatrixView<double>& input_list, const ConstMatrixView<double>& target_list) {
         query(input_list);
-        backpropogate(input_list, target_list);
+        backpropogate(input_list, target_list, 0);
     }
 
-    const Matrix<double>& query(const Vertex<double>& input_list) {
-        auto input = m_weights[0].dot(input_list);
-        m_outputs[0] = activate(input);
+    // A frozen layer keeps its weights: training still passes the error
+    // through it to the layers below, but never updates it.
+    void freeze(const int& layer, const bool& frozen = true) {
+        if(layer < 0 || layer >= m_weights.size()) {
+            throw std::out_of_range("no layer " + std::to_string(layer));
+        }
+        m_frozen[layer] = frozen;
+    }
 
-        for(int i=1; i<m_weights.size(); ++i) {
-            input = m_weights[i].dot(m_outputs[i-1]);
-            m_outputs[i] = activate(input); 
+    bool isFrozen(const int& layer) const {
+        return m_frozen[layer];
+    }
+
+    // Number of leading frozen layers. Their outputs only depend on the
+    // input, so they can be computed once per dataset (see FeatureCache).
+    int getFrozenLayers() const {
+        int frozen = 0;
+        while(frozen < m_weights.size() && m_frozen[frozen]) {
+            ++frozen;
         }
+        return frozen;
+    }
 
-        return m_outputs.back();
+    // Same as train() for a sample whose leading frozen layers have
+    // already been run: features is the output of the last of them.
+    void trainFrozen(const ConstMatrixView<double>& features, const ConstMatrixView<double>& target_list) {
+        const int first = getFrozenLayers();
+        if(first == m_weights.size()) {
+            throw std::invalid_argument("every layer is frozen");
+        }
+        forward(features, first);
+        backpropogate(features, target_list, first);
+    }
+
+    // Adds the sample's weight gradients to getGradients() without
+    // touching the weights. onLayer(i) is called as soon as layer i's
+    // gradient is complete, last layer first.
+    void accumulate(const ConstMatrixView<double>& input_list, const ConstMatrixView<double>& target_list, const std::function<void(const int&)>& onLayer = nullptr) {
+        query(input_list);
+        getGradients();
+
+        auto error = target_list.copy() - m_outputs.back();
+        m_error = error;
+
+        const int frozen = getFrozenLayers();
+        for(int i=m_weights.size()-1; i>=0; --i) {
+            const auto input = (i > 0)? ConstMatrixView<double>(m_outputs[i-1]): input_list;
+            if(!m_frozen[i]) {
+                gemm<double>(error * m_outputs[i] * (1.0 - m_outputs[i]), input.transpose(), m_gradients[i], 1.0, true);
+            }
+            if(onLayer) {
+                onLayer(i);
+            }
+            if(i > frozen) {
+                error = dot<double>(ConstMatrixView<double>(m_weights[i]).transpose(), error);
+            }
+        }
+    }
+
+    std::vector<Matrix<double>>& getGradients() {
+        if(m_gradients.size() != m_weights.size()) {
+            m_gradients.clear();
+            for(const auto& weight: m_weights) {
+                m_gradients.emplace_back(weight.getRows(), weight.getCols());
+            }
+        }
+        return m_gradients;
+    }
+
+    void applyGradients(const double& scale = 1.0) {
+        PROFILE_SCOPE("applyGradients");
+        m_transposed.clear();
+        for(int i=0; i<m_gradients.size(); ++i) {
+            m_weights[i] += (m_learningRate * scale) * m_gradients[i];
+            std::fill(m_gradients[i].data(), m_gradients[i].data() + m_gradients[i].getRows()*m_gradients[i].getCols(), 0.0);
+        }
     }
 
-    Matrix<double> reverse_query(const Vertex<double>& input_list) {
+    const Matrix<double>& query(const ConstMatrixView<double>& input_list) {
+        PROFILE_SCOPE("query");
+        return forward(input_list, 0);
+    }
 
-        auto input = m_weights.back().transpose().dot(input_list);
+    Matrix<double> reverse_query(const ConstMatrixView<double>& target_list) {
+        const auto& transposed = transposedWeights();
+
+        auto input = dot<double>(transposed.back(), target_list);
         auto output = reverseActivate(input);
 
-        for(int i=m_weights.size()-2; i>=0; --i) {
-            input = m_weights[i].transpose().dot(output);
+        for(int i=transposed.size()-2; i>=0; --i) {
+            input = transposed[i].dot(output);
             output = reverseActivate(input); 
         }
 
         return output;
     }
 
-    void saveModel(const std::string& fileName) const {
-        DnnModel model{m_learningRate, m_weights};
-        model.saveModel(fileName);
+    DnnModel getModel() const {
+        return DnnModel{m_learningRate, m_weights};
     }
-private:
-    double expit(const double& val) {
-        return 1/(1 + std::exp(-val));
+
+    void snapshot(DnnModel& model) const {
+        model.m_learningRate = m_learningRate;
+        model.m_weights = m_weights;
     }
 
-    double logit(const double& val) {
-        auto value = (val<=0)? 0.01: (val>=1)? 0.99: val;
-        return  std::log(std::abs(value/(1-value)));
+    void saveModel(const std::string& fileName) const {
+        getModel().saveModel(fileName);
     }
+private:
+    // Runs the layers from first on; input_list is the output of the layer
+    // before it.
+    const Matrix<double>& forward(const ConstMatrixView<double>& input_list, const int& first) {
+        auto input = dot<double>(m_weights[first], input_list);
+        m_outputs[first] = activate(input);
 
-    template<typename T>
-    Matrix<T> activate(const Matrix<T>& matrix) {
-        auto mat = matrix;
-        for(int i=0; i<mat.getRows(); ++i) {
-            for(int j=0; j<mat.getCols(); ++j) {
-                mat[i][j] = expit(mat[i][j]);
-            }
+        for(int i=first+1; i<m_weights.size(); ++i) {
+            input = m_weights[i].dot(m_outputs[i-1]);
+            m_outputs[i] = activate(input); 
         }
-        return mat;
+
+        return m_outputs.back();
     }
 
-    template<typename T>
-    Matrix<T> reverseActivate(const Matrix<T>& matrix) {
-        auto mat = matrix;
-        for(int i=0; i<mat.getRows(); ++i) {
-            for(int j=0; j<mat.getCols(); ++j) {
-                mat[i][j] = logit(mat[i][j]);
+    const std::vector<Matrix<double>>& transposedWeights() {
+        if(m_transposed.empty()) {
+            for(const auto& weight: m_weights) {
+                m_transposed.push_back(weight.transpose());
             }
         }
-        return mat;
+        return m_transposed;
     }
 
-    void backpropogate(const Vertex<double>& input_list, const Vertex<double>& target_list) {
-        auto error = target_list - m_outputs.back();
+    // Updates the layers from first on, where input_list fed layer first.
+    // The error stops at the lowest layer that is not frozen.
+    void backpropogate(const ConstMatrixView<double>& input_list, const ConstMatrixView<double>& target_list, const int& first) {
+        PROFILE_SCOPE("backpropogate");
+        m_transposed.clear();
+        auto error = target_list.copy() - m_outputs.back();
         m_error = error;
 
-        for(int i=m_weights.size()-1; i>=1; --i) {
-            m_weights[i] += m_learningRate * (error * m_outputs[i] * (1.0 - m_outputs[i])).dot(m_outputs[i-1].transpose());
-            error = m_weights[i].transpose().dot(error);
+        int lowest = first;
+        while(lowest < m_weights.size() && m_frozen[lowest]) {
+            ++lowest;
+        }
+        for(int i=m_weights.size()-1; i>=lowest; --i) {
+            const auto input = (i > first)? ConstMatrixView<double>(m_outputs[i-1]): input_list;
+            if(!m_frozen[i]) {
+                gemm<double>(error * m_outputs[i] * (1.0 - m_outputs[i]), input.transpose(), m_weights[i], m_learningRate, true);
+            }
+            if(i > lowest) {
+                error = dot<double>(ConstMatrixView<double>(m_weights[i]).transpose(), error);
+            }
         }
-
-        m_weights[0] += m_learningRate * (error * m_outputs[0] * (1.0 - m_outputs[0])).dot(input_list.transpose());
     }
 private:
     double m_learningRate;
     Matrix<double> m_error;
     std::vector<Matrix<double>> m_weights;
     std::vector<Matrix<double>> m_outputs;
+    std::vector<Matrix<double>> m_transposed;
+    std::vector<Matrix<double>> m_gradients;
+    std::vector<bool> m_frozen;
 };
 
 #endif
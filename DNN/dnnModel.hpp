@@ -30,27 +30,42 @@ struct DnnModel {
             throw std::invalid_argument(extension + ": no file format for extension");
         }
     }
-    
-private:
-    void saveRawModel(const std::string& fileName) const {
-        std::ofstream file(fileName);
-        file.exceptions(std::ios::failbit | std::ios::badbit);
 
+    void write(std::ostream& file) const {
         file.write((char*)&m_learningRate, sizeof(m_learningRate));
         int size = m_weights.size();
         file.write((char*)&size, sizeof(size));
-        
+
         for(const auto& weight: m_weights) {
             file.write((char*)&weight.getRows(), sizeof(weight.getRows()));
-            file.write((char*)& weight.getCols(), sizeof( weight.getCols()));
-            for(int i=0; i<weight.getRows(); ++i) {
-                for(int j=0; j<weight.getCols(); ++j) {
-                    file.write((char*)&weight[i][j], sizeof(weight[i][j]));
-                }
-            }
+            file.write((char*)&weight.getCols(), sizeof(weight.getCols()));
+            file.write((char*)weight.data(), sizeof(double) * weight.getRows() * weight.getCols());
         }
     }
 
+    static DnnModel read(std::istream& file) {
+        DnnModel model;
+        file.read((char*)&model.m_learningRate, sizeof(model.m_learningRate));
+        int weightCount;
+        file.read((char*)&weightCount, sizeof(weightCount));
+        int rows, cols;
+        for(int i=0; i<weightCount; ++i) {
+            file.read((char*)&rows, sizeof(rows));
+            file.read((char*)&cols, sizeof(cols));
+            Matrix<double> weight(rows, cols);
+            file.read((char*)weight.data(), sizeof(double) * rows * cols);
+            model.m_weights.push_back(weight);
+        }
+        return model;
+    }
+
+private:
+    void saveRawModel(const std::string& fileName) const {
+        std::ofstream file(fileName, std::ios::binary);
+        file.exceptions(std::ios::failbit | std::ios::badbit);
+        write(file);
+    }
+
     void saveFormatedModel(const std::string& fileName) const {
         std::ofstream file(fileName);
         file.exceptions(std::ios::failbit | std::ios::badbit);
@@ -68,26 +83,9 @@ private:
     }
 
     static DnnModel loadRawModel(const std::string& fileName) {
-        std::ifstream file(fileName);
+        std::ifstream file(fileName, std::ios::binary);
         file.exceptions(std::ios::failbit | std::ios::badbit);
-
-        DnnModel model;
-        file.read((char*)&model.m_learningRate, sizeof(model.m_learningRate));
-        int weightCount;
-        file.read((char*)&weightCount, sizeof(weightCount));
-        int rows, cols;
-        for(int i=0; i<weightCount; ++i) {
-            file.read((char*)&rows, sizeof(rows));
-            file.read((char*)&cols, sizeof(cols));
-            Matrix<double> weight(rows, cols);
-            for(int j=0; j<rows; ++j) {
-                for(int k=0; k<cols; ++k) {
-                    file.read((char*)&weight[j][k], sizeof(weight[j][k]));
-                }
-            }
-            model.m_weights.push_back(weight);
-        }
-        return model;
+        return read(file);
     }
 
     static DnnModel loadFormatedModel(const std::string& fileName) {
@@ -0,0 +1,104 @@
+#ifndef ENSEMBLE_HPP
+#define ENSEMBLE_HPP
+
+#include "matrixView.hpp"
+#include "activation.hpp"
+#include "dnnModel.hpp"
+#include <vector>
+#include <stdexcept>
+
+// Runs K dense models that share an input as one network. The first layers
+// are stacked into a single (sum of rows x inputs) matrix so the input is
+// streamed once by one product; each model then continues on its own
+// block of that result and the K outputs are combined.
+class Ensemble {
+public:
+    enum class Combine {
+        mean,   // average of the output activations
+        vote    // share of models whose argmax picked each class
+    };
+
+    Ensemble(const std::vector<DnnModel>& models, const Combine& combine = Combine::mean)
+    :   m_combine(combine) {
+
+        if(models.empty()) {
+            throw std::invalid_argument("ensemble needs atleast one model");
+        }
+        const int inputs = models[0].m_weights.front().getCols();
+        const int outputs = models[0].m_weights.back().getRows();
+
+        int rows = 0;
+        for(const auto& model: models) {
+            if(model.m_weights.empty()) {
+                throw std::length_error("Network needs atleast two layers.");
+            }
+            if(model.m_weights.front().getCols() != inputs || model.m_weights.back().getRows() != outputs) {
+                throw std::length_error("ensemble models must have the same inputs and outputs");
+            }
+            m_offsets.push_back(rows);
+            rows += model.m_weights.front().getRows();
+            m_layers.emplace_back(model.m_weights.begin() + 1, model.m_weights.end());
+        }
+        m_offsets.push_back(rows);
+
+        m_stacked = Matrix<double>(rows, inputs);
+        for(int k=0; k<models.size(); ++k) {
+            const auto& first = models[k].m_weights.front();
+            std::copy(first.data(), first.data() + first.getRows()*first.getCols(), m_stacked.data() + m_offsets[k]*inputs);
+        }
+        m_outputs.resize(models.size());
+    }
+
+    int getSize() const {
+        return m_layers.size();
+    }
+
+    // Inputs are (inputs x batch); the result is (outputs x batch).
+    const Matrix<double>& query(const ConstMatrixView<double>& input) {
+        const int batch = input.getCols();
+        m_hidden = activate(dot<double>(m_stacked, input));
+
+        for(int k=0; k<m_layers.size(); ++k) {
+            ConstMatrixView<double> x = ConstMatrixView<double>(m_hidden).block(m_offsets[k], 0, m_offsets[k+1] - m_offsets[k], batch);
+            if(m_layers[k].empty()) {
+                m_outputs[k] = x.copy();
+            }
+            for(const auto& weight: m_layers[k]) {
+                m_outputs[k] = activate(dot<double>(weight, x));
+                x = m_outputs[k];
+            }
+        }
+
+        const auto& first = m_outputs[0];
+        m_result = Matrix<double>(first.getRows(), batch);
+        std::fill(m_result.data(), m_result.data() + first.getRows()*batch, 0.0);
+        for(const auto& output: m_outputs) {
+            for(int j=0; j<batch; ++j) {
+                if(m_combine == Combine::vote) {
+                    int best = 0;
+                    for(int i=1; i<output.getRows(); ++i) {
+                        if(output[i][j] > output[best][j]) {
+                            best = i;
+                        }
+                    }
+                    m_result[best][j] += 1.0 / m_outputs.size();
+                } else {
+                    for(int i=0; i<output.getRows(); ++i) {
+                        m_result[i][j] += output[i][j] / m_outputs.size();
+                    }
+                }
+            }
+        }
+        return m_result;
+    }
+private:
+    Combine m_combine;
+    Matrix<double> m_stacked;
+    std::vector<int> m_offsets;
+    std::vector<std::vector<Matrix<double>>> m_layers;
+    Matrix<double> m_hidden;
+    std::vector<Matrix<double>> m_outputs;
+    Matrix<double> m_result;
+};
+
+#endif
@@ -0,0 +1,151 @@
+#ifndef EXECUTOR_HPP
+#define EXECUTOR_HPP
+
+#include "kernels.hpp"
+#include "matrixView.hpp"
+#include "activation.hpp"
+#include "dnnModel.hpp"
+#include "memoryPlan.hpp"
+#include <vector>
+#include <string>
+#include <cmath>
+
+// Runs a dense sigmoid network out of one preallocated arena. Buffers are
+// planned once for a fixed batch size, so query() and train() never
+// allocate. Inputs and targets are (nodes x batch) views, so a batch can
+// be a transposed block of a sample-per-row dataset buffer. Outputs are
+// (nodes x batch) row major, the same layout as Matrix.
+//
+// Training steps are numbered forward layer 0..L-1 then backward layer
+// L-1..0, so layer i runs forward at step i and backward at 2L-1-i.
+class Executor {
+public:
+    Executor(const DnnModel& model, const int& batch = 1, const bool& training = true)
+    :   m_learningRate(model.m_learningRate),
+        m_batch(batch),
+        m_training(training),
+        m_weights(model.m_weights) {
+
+        if(m_weights.empty()) {
+            throw std::length_error("Network needs atleast two layers.");
+        }
+
+        const int L = m_weights.size();
+        for(int i=0; i<L; ++i) {
+            if(i > 0 && m_weights[i].getCols() != m_weights[i-1].getRows()) {
+                throw std::length_error("mismatched layer sizes in model");
+            }
+            const std::size_t size = m_weights[i].getRows() * batch;
+            const int last = training? 2*L-1-i: std::min(i+1, L-1);
+            m_outputs.push_back(m_plan.add("output" + std::to_string(i), size, i, last));
+        }
+
+        if(training) {
+            m_errors.resize(L);
+            for(int i=0; i<L; ++i) {
+                const std::size_t size = m_weights[i].getRows() * batch;
+                const int first = (i == L-1)? L: 2*L-2-i;
+                m_errors[i] = m_plan.add("error" + std::to_string(i), size, first, 2*L-1-i);
+            }
+        }
+
+        m_plan.plan();
+        m_arena.resize(m_plan.getPeak());
+    }
+
+    const double* query(const double* input) {
+        return query(ConstMatrixView<double>(input, m_weights[0].getCols(), m_batch, m_batch));
+    }
+
+    const double* query(const ConstMatrixView<double>& input) {
+        const double* in = nullptr;
+        for(int i=0; i<m_weights.size(); ++i) {
+            const auto& weight = m_weights[i];
+            double* out = buffer(m_outputs[i]);
+            if(i == 0) {
+                gemm<double>(weight, input, MatrixView<double>(out, weight.getRows(), m_batch, m_batch));
+            } else {
+                gemm(weight.getRows(), m_batch, weight.getCols(), weight.data(), in, out);
+            }
+            for(int j=0; j<weight.getRows()*m_batch; ++j) {
+                out[j] = expit(out[j]);
+            }
+            in = out;
+        }
+        return in;
+    }
+
+    void train(const double* input, const double* target) {
+        train(ConstMatrixView<double>(input, m_weights[0].getCols(), m_batch, m_batch),
+              ConstMatrixView<double>(target, m_weights.back().getRows(), m_batch, m_batch));
+    }
+
+    void train(const ConstMatrixView<double>& input, const ConstMatrixView<double>& target) {
+        if(!m_training) {
+            throw std::logic_error("executor was planned for inference only");
+        }
+        query(input);
+
+        const int L = m_weights.size();
+        const int outputs = m_weights.back().getRows() * m_batch;
+        const double* out = buffer(m_outputs[L-1]);
+        double* delta = buffer(m_errors[L-1]);
+
+        m_error = 0;
+        for(int j=0; j<outputs; ++j) {
+            const double error = target(j / m_batch, j % m_batch) - out[j];
+            m_error += error * error;
+            delta[j] = error * out[j] * (1.0 - out[j]);
+        }
+        m_error = std::sqrt(m_error / outputs);
+
+        for(int i=L-1; i>=0; --i) {
+            auto& weight = m_weights[i];
+            delta = buffer(m_errors[i]);
+
+            if(i > 0) {
+                const double* in = buffer(m_outputs[i-1]);
+                double* previous = buffer(m_errors[i-1]);
+                gemmTransA(weight.getCols(), m_batch, weight.getRows(), weight.data(), delta, previous);
+                for(int j=0; j<weight.getCols()*m_batch; ++j) {
+                    previous[j] *= in[j] * (1.0 - in[j]);
+                }
+                gemmTransB(weight.getRows(), weight.getCols(), m_batch, m_learningRate, delta, in, weight.data());
+            } else {
+                gemm<double>(ConstMatrixView<double>(delta, weight.getRows(), m_batch, m_batch), input.transpose(), weight, m_learningRate, true);
+            }
+        }
+    }
+
+    double getError() const {
+        return m_error;
+    }
+
+    const int& getBatch() const {
+        return m_batch;
+    }
+
+    const MemoryPlan& getPlan() const {
+        return m_plan;
+    }
+
+    DnnModel getModel() const {
+        return DnnModel{m_learningRate, m_weights};
+    }
+private:
+    double* buffer(const int& id) {
+        return m_arena.data() + m_plan.getOffset(id);
+    }
+private:
+    double m_learningRate;
+    double m_error = 0;
+    int m_batch;
+    bool m_training;
+    std::vector<Matrix<double>> m_weights;
+    std::vector<int> m_outputs;
+    std::vector<int> m_errors;
+    MemoryPlan m_plan;
+    std::vector<double> m_arena;
+};
+
+#endif
@@ -0,0 +1,197 @@
+#ifndef FEATURE_CACHE_HPP
+#define FEATURE_CACHE_HPP
+
+#include "dnn.hpp"
+#include "inferenceSession.hpp"
+#include "matrixView.hpp"
+#include <vector>
+#include <string>
+#include <memory>
+#include <cstdint>
+#include <cstring>
+#include <algorithm>
+#include <stdexcept>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+// Outputs of a network's leading frozen layers for a whole dataset, so
+// fine-tuning epochs only run the trainable layers (DNN::trainFrozen).
+// The frozen layers run once, in batches, and their outputs are kept as
+// floats, one row per sample.
+//
+// Given a file name the features live in that file, mapped into memory.
+// A later cache over the same samples and frozen weights maps the file
+// again instead of recomputing it.
+class FeatureCache {
+public:
+    FeatureCache(const DNN& net, const ConstMatrixView<double>& samples, const std::vector<int>& labels, const std::string& fileName = "")
+    :   m_labels(labels) {
+
+        const auto model = net.getModel();
+        const int frozen = net.getFrozenLayers();
+        if(labels.size() != samples.getRows()) {
+            throw std::length_error("feature cache needs one label per sample");
+        }
+        if(samples.getCols() != model.m_weights.front().getCols()) {
+            throw std::length_error("samples do not match the network inputs");
+        }
+        m_width = frozen? model.m_weights[frozen-1].getRows(): samples.getCols();
+        m_sample.resize(m_width);
+
+        const Header header = { { 'D', 'F', 'C', '1' }, getRows(), m_width, 0, key(model, frozen, samples) };
+        const std::size_t bytes = sizeof(Header) + std::size_t(getRows()) * m_width * sizeof(float);
+        if(fileName.empty()) {
+            m_buffer.resize(std::size_t(getRows()) * m_width);
+            m_features = m_buffer.data();
+        } else if(map(fileName, header, bytes)) {
+            m_reused = true;
+            return;
+        }
+
+        const int chunk = 256;
+        std::unique_ptr<InferenceSession> session;
+        if(frozen) {
+            session = std::make_unique<InferenceSession>(DnnModel{model.m_learningRate, {model.m_weights.begin(), model.m_weights.begin() + frozen}});
+        }
+        InferenceSession::Context context(false);
+        for(int first=0; first<getRows(); first+=chunk) {
+            const int count = std::min(chunk, getRows() - first);
+            auto input = samples.block(first, 0, count, samples.getCols()).transpose();
+            const auto output = session? session->query(context, input): input;
+            for(int j=0; j<count; ++j) {
+                float* row = m_features + std::size_t(first + j) * m_width;
+                for(int i=0; i<m_width; ++i) {
+                    row[i] = output(i, j);
+                }
+            }
+        }
+        // The header goes in last, once the features are on disk, so an
+        // interrupted build never looks like a valid cache.
+        if(m_mapping) {
+            ::msync(m_mapping, m_mappedBytes, MS_SYNC);
+            std::memcpy(m_mapping, &header, sizeof(Header));
+            ::msync(m_mapping, sizeof(Header), MS_SYNC);
+        }
+    }
+
+    FeatureCache(const FeatureCache&) = delete;
+    FeatureCache& operator=(const FeatureCache&) = delete;
+
+    ~FeatureCache() {
+        if(m_mapping) {
+            ::munmap(m_mapping, m_mappedBytes);
+        }
+    }
+
+    int getRows() const {
+        return m_labels.size();
+    }
+
+    const int& getWidth() const {
+        return m_width;
+    }
+
+    const std::vector<int>& getLabels() const {
+        return m_labels;
+    }
+
+    // Sample i as a (width x 1) column, widened into a buffer that the
+    // next call overwrites.
+    ConstMatrixView<double> getSample(const int& i) {
+        const float* row = m_features + std::size_t(i) * m_width;
+        std::copy(row, row + m_width, m_sample.begin());
+        return ConstMatrixView<double>(m_sample);
+    }
+
+    std::size_t getBytes() const {
+        return std::size_t(getRows()) * m_width * sizeof(float);
+    }
+
+    bool isMapped() const {
+        return m_mapping != nullptr;
+    }
+
+    // Whether the features were mapped from an earlier cache file.
+    bool isReused() const {
+        return m_reused;
+    }
+private:
+    // Written and compared as raw bytes, so it must not have padding.
+    struct Header {
+        char magic[4];
+        std::int32_t rows;
+        std::int32_t width;
+        std::uint32_t reserved;
+        std::uint64_t key;
+    };
+    static_assert(sizeof(Header) == 24, "feature cache header has padding");
+
+    // Identifies the frozen weights and the samples a cache was built from.
+    static std::uint64_t key(const DnnModel& model, const int& frozen, const ConstMatrixView<double>& samples) {
+        std::uint64_t hash = 14695981039346656037ull;
+        auto add = [&](const double& value) {
+            std::uint64_t bits;
+            std::memcpy(&bits, &value, sizeof(bits));
+            hash = (hash ^ bits) * 1099511628211ull;
+        };
+        for(int k=0; k<frozen; ++k) {
+            const auto& weight = model.m_weights[k];
+            add(weight.getRows());
+            for(int i=0; i<weight.getRows()*weight.getCols(); ++i) {
+                add(weight.data()[i]);
+            }
+        }
+        for(int i=0; i<samples.getRows(); ++i) {
+            for(int j=0; j<samples.getCols(); ++j) {
+                add(samples(i, j));
+            }
+        }
+        return hash;
+    }
+
+    // Maps fileName; returns true if it already holds this cache,
+    // otherwise resizes it and clears the header for the caller to fill.
+    bool map(const std::string& fileName, const Header& header, const std::size_t& bytes) {
+        int fd = ::open(fileName.c_str(), O_RDWR | O_CREAT, 0644);
+        if(fd == -1) {
+            throw std::invalid_argument(fileName + " not available");
+        }
+        struct stat status;
+        ::fstat(fd, &status);
+
+        Header existing;
+        const bool reuse = std::size_t(status.st_size) == bytes &&
+                           ::pread(fd, &existing, sizeof(existing), 0) == sizeof(existing) &&
+                           std::memcmp(&existing, &header, sizeof(Header)) == 0;
+        if(!reuse && ::ftruncate(fd, bytes) != 0) {
+            ::close(fd);
+            throw std::runtime_error(fileName + ": could not resize feature cache");
+        }
+
+        void* mapping = ::mmap(nullptr, bytes, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+        ::close(fd);
+        if(mapping == MAP_FAILED) {
+            throw std::runtime_error(fileName + ": could not map feature cache");
+        }
+        m_mapping = mapping;
+        m_mappedBytes = bytes;
+        m_features = reinterpret_cast<float*>(static_cast<char*>(mapping) + sizeof(Header));
+        if(!reuse) {
+            std::memset(mapping, 0, sizeof(Header));
+        }
+        return reuse;
+    }
+private:
+    std::vector<int> m_labels;
+    int m_width;
+    float* m_features = nullptr;
+    std::vector<float> m_buffer;
+    void* m_mapping = nullptr;
+    std::size_t m_mappedBytes = 0;
+    bool m_reused = false;
+    std::vector<double> m_sample;
+};
+
+#endif
@@ -0,0 +1,159 @@
+#ifndef GEMM_AUTOTUNER_HPP
+#define GEMM_AUTOTUNER_HPP
+
+#include "kernels.hpp"
+#include <vector>
+#include <chrono>
+#include <random>
+#include <limits>
+#include <stdexcept>
+
+// Measures candidate configurations for the products a dense network runs
+// and records the fastest in GemmTuning. A network with layers
+// n0, n1, ..., nL trained on batches of b columns runs, per layer of
+// (out x in) weights,
+//
+//     forward     gemmNN(out, b, in)
+//     error       gemmTN(in, b, out)
+//     gradient    gemmNT(out, in, b)
+//
+// Candidates are grains of m, m/2, ..., m/16 rows plus the default
+// threshold, and for gemmNN with more than one column also K blocks of
+// 32 to 256 and both loop orders. Every candidate is timed as the best of
+// several runs, each long enough to be well above timer resolution. The
+// best candidate only replaces the default when it is faster by atleast
+// minimumGain (a fraction of the default's time); smaller differences
+// are timing noise and are not written to the cache.
+class GemmAutotuner {
+public:
+    struct Result {
+        GemmKernel kernel;
+        int m, n, k;
+        GemmConfig config;
+        double defaultSeconds;
+        double tunedSeconds;
+    };
+
+    GemmAutotuner(const int& trials = 5, const double& minimumGain = 0.05)
+    :   m_trials(trials),
+        m_minimumGain(minimumGain) {}
+
+    std::vector<Result> tune(const std::vector<int>& topology, const int& batch) {
+        if(topology.size() < 2) {
+            throw std::length_error("Network needs atleast two layers.");
+        }
+        std::vector<Result> results;
+        for(int i=1; i<topology.size(); ++i) {
+            const int in = topology[i-1], out = topology[i];
+            results.push_back(tune(GemmKernel::nn, out, batch, in));
+            results.push_back(tune(GemmKernel::tn, in, batch, out));
+            results.push_back(tune(GemmKernel::nt, out, in, batch));
+        }
+        return results;
+    }
+
+    Result tune(const GemmKernel& kernel, const int& m, const int& n, const int& k) {
+        auto& tuning = GemmTuning::instance();
+        tuning.erase(kernel, m, n, k);
+
+        std::mt19937 generator(m ^ (n << 10) ^ (k << 20));
+        std::uniform_real_distribution<double> uniform(-1.0, 1.0);
+        std::vector<double> a(long(m)*k), b(long(k)*n), c(long(m)*n);
+        for(auto& value: a) {
+            value = uniform(generator);
+        }
+        for(auto& value: b) {
+            value = uniform(generator);
+        }
+
+        auto run = [&] {
+            switch(kernel) {
+            case GemmKernel::nn:
+                gemmNN(m, n, k, 1.0, a.data(), k, b.data(), n, c.data(), n, false);
+                break;
+            case GemmKernel::tn:
+                gemmTN(m, n, k, 1.0, a.data(), m, b.data(), n, c.data(), n, false);
+                break;
+            case GemmKernel::nt:
+                gemmNT(m, n, k, 1.0, a.data(), k, b.data(), k, c.data(), n, false);
+                break;
+            }
+        };
+
+        // Enough calls per trial for roughly a millisecond of work.
+        run();
+        const auto once = std::chrono::steady_clock::now();
+        run();
+        const double estimate = std::chrono::duration<double>(std::chrono::steady_clock::now() - once).count();
+        const int calls = std::max(1, int(1e-3 / std::max(estimate, 1e-9)));
+
+        auto measure = [&] {
+            double best = std::numeric_limits<double>::max();
+            for(int t=0; t<m_trials; ++t) {
+                const auto start = std::chrono::steady_clock::now();
+                for(int i=0; i<calls; ++i) {
+                    run();
+                }
+                const std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+                best = std::min(best, elapsed.count() / calls);
+            }
+            return best;
+        };
+
+        Result result{ kernel, m, n, k, gemmConfig(kernel, m, n, k), 0, 0 };
+        result.defaultSeconds = measure();
+        GemmConfig best = result.config;
+        double bestSeconds = std::numeric_limits<double>::max();
+        for(const auto& candidate: candidates(kernel, m, n, k)) {
+            tuning.set(kernel, m, n, k, candidate);
+            const double seconds = measure();
+            if(seconds < bestSeconds) {
+                bestSeconds = seconds;
+                best = candidate;
+            }
+        }
+
+        if(bestSeconds < result.defaultSeconds * (1 - m_minimumGain)) {
+            result.config = best;
+            result.tunedSeconds = bestSeconds;
+            tuning.set(kernel, m, n, k, best);
+        } else {
+            result.tunedSeconds = result.defaultSeconds;
+            tuning.erase(kernel, m, n, k);
+        }
+        return result;
+    }
+private:
+    static std::vector<GemmConfig> candidates(const GemmKernel& kernel, const int& m, const int& n, const int& k) {
+        std::vector<int> grains = { rowGrain(m, long(n)*k) };
+        for(int divisor=1; divisor<=16; divisor*=2) {
+            const int grain = (m + divisor - 1) / divisor;
+            if(std::find(grains.begin(), grains.end(), grain) == grains.end()) {
+                grains.push_back(grain);
+            }
+        }
+
+        std::vector<int> blocks = { k };
+        if(kernel == GemmKernel::nn && n > 1) {
+            for(int block=32; block<=256 && block<k; block*=2) {
+                blocks.push_back(block);
+            }
+        }
+        const int orders = (kernel == GemmKernel::nn && n > 1)? 2: 1;
+
+        std::vector<GemmConfig> configs;
+        for(auto grain: grains) {
+            for(auto block: blocks) {
+                for(int order=0; order<orders; ++order) {
+                    configs.push_back({ grain, block, order });
+                }
+            }
+        }
+        return configs;
+    }
+private:
+    int m_trials;
+    double m_minimumGain;
+};
+
+#endif
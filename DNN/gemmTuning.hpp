@@ -0,0 +1,156 @@
+#ifndef GEMM_TUNING_HPP
+#define GEMM_TUNING_HPP
+
+#include <unordered_map>
+#include <string>
+#include <fstream>
+#include <filesystem>
+#include <sstream>
+#include <stdexcept>
+#include <cstdint>
+#include <cstdlib>
+#include <cstdio>
+
+enum class GemmKernel {
+    nn, tn, nt
+};
+
+// How one product shape is run. grain is the number of output rows per
+// scheduler task (the whole product runs on the caller when grain >= m).
+// blockK and order only apply to gemmNN with more than one column:
+// blockK splits the inner dimension so a panel of b stays in cache across
+// rows, and order 1 walks the panel row by row for all rows of the chunk
+// instead of row by row of c. None of them change the order in which a
+// single output element is summed, so results are bitwise identical.
+struct GemmConfig {
+    int grain;
+    int blockK;
+    int order;
+};
+
+// Winning configurations per (kernel, m, n, k) for this machine. Loaded
+// once from the tuning cache, whose lines are
+//
+//     <cpu model>\t<kernel> <m> <n> <k> <grain> <blockK> <order>
+//
+// Only lines for the CPU this process runs on are used, so one file can be
+// shared by a mixed fleet. The cache lives in $DNN_TUNING, or in
+// $HOME/.cache/dnn-gemm.tune when that is not set.
+class GemmTuning {
+private:
+    GemmTuning()
+    :   m_cpu(cpuModel()) {
+        load();
+    }
+public:
+    GemmTuning(const GemmTuning&) = delete;
+    GemmTuning& operator=(const GemmTuning&) = delete;
+
+    static GemmTuning& instance() {
+        static GemmTuning tuning;
+        return tuning;
+    }
+
+    const GemmConfig* find(const GemmKernel& kernel, const int& m, const int& n, const int& k) const {
+        if(m_configs.empty()) {
+            return nullptr;
+        }
+        auto found = m_configs.find(key(kernel, m, n, k));
+        return (found == m_configs.end())? nullptr: &found->second;
+    }
+
+    // Not thread safe: only call while no kernels are running.
+    void set(const GemmKernel& kernel, const int& m, const int& n, const int& k, const GemmConfig& config) {
+        m_configs[key(kernel, m, n, k)] = config;
+    }
+
+    void erase(const GemmKernel& kernel, const int& m, const int& n, const int& k) {
+        m_configs.erase(key(kernel, m, n, k));
+    }
+
+    // Rewrites the cache: entries for other CPUs are kept, entries for
+    // this one are replaced by the current table.
+    void save() const {
+        std::string others;
+        {
+            std::ifstream file(path());
+            std::string line;
+            while(std::getline(file, line)) {
+                if(line.substr(0, line.find('\t')) != m_cpu) {
+                    others += line + '\n';
+                }
+            }
+        }
+
+        const auto fileName = path();
+        const auto directory = std::filesystem::path(fileName).parent_path();
+        std::error_code error;
+        if(!directory.empty()) {
+            std::filesystem::create_directories(directory, error);
+        }
+        std::ofstream file(fileName + ".tmp");
+        if(!file) {
+            throw std::runtime_error(fileName + ": cannot write tuning cache");
+        }
+        file << others;
+        for(const auto& entry: m_configs) {
+            const auto& c = entry.second;
+            file << m_cpu << '\t' << int(entry.first >> 60) << ' ' << ((entry.first >> 40) & 0xfffff) << ' '
+                 << ((entry.first >> 20) & 0xfffff) << ' ' << (entry.first & 0xfffff) << ' '
+                 << c.grain << ' ' << c.blockK << ' ' << c.order << '\n';
+        }
+        file.close();
+        std::rename((fileName + ".tmp").c_str(), fileName.c_str());
+    }
+
+    const std::string& getCpu() const {
+        return m_cpu;
+    }
+
+    static std::string path() {
+        if(auto env = std::getenv("DNN_TUNING")) {
+            return env;
+        }
+        auto home = std::getenv("HOME");
+        return std::string(home? home: ".") + "/.cache/dnn-gemm.tune";
+    }
+
+    static std::string cpuModel() {
+        std::ifstream file("/proc/cpuinfo");
+        std::string line;
+        while(std::getline(file, line)) {
+            if(line.compare(0, 10, "model name") == 0) {
+                auto value = line.substr(line.find(':') + 1);
+                value.erase(0, value.find_first_not_of(' '));
+                return value;
+            }
+        }
+        return "unknown";
+    }
+private:
+    static std::uint64_t key(const GemmKernel& kernel, const int& m, const int& n, const int& k) {
+        return (std::uint64_t(kernel) << 60) | (std::uint64_t(m & 0xfffff) << 40) | (std::uint64_t(n & 0xfffff) << 20) | std::uint64_t(k & 0xfffff);
+    }
+
+    void load() {
+        std::ifstream file(path());
+        std::string line;
+        while(std::getline(file, line)) {
+            const auto tab = line.find('\t');
+            if(tab == std::string::npos || line.substr(0, tab) != m_cpu) {
+                continue;
+            }
+            std::istringstream fields(line.substr(tab + 1));
+            int kernel, m, n, k;
+            GemmConfig config;
+            if(fields >> kernel >> m >> n >> k >> config.grain >> config.blockK >> config.order) {
+                set(GemmKernel(kernel), m, n, k, config);
+            }
+        }
+    }
+private:
+    std::string m_cpu;
+    std::unordered_map<std::uint64_t, GemmConfig> m_configs;
+};
+
+#endif
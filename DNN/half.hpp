@@ -0,0 +1,199 @@
+#ifndef HALF_HPP
+#define HALF_HPP
+
+#include "kernels.hpp"
+#include <cstdint>
+#include <cstring>
+#include <cmath>
+#if defined(__x86_64__)
+#include <immintrin.h>
+#endif
+
+// 16 bit weight formats. Both keep the raw bits and are only ever widened
+// to float for arithmetic; narrowing rounds to nearest even.
+//
+// bfloat16 is the top half of a float: same range, 8 bits of mantissa.
+// float16 is IEEE half: 11 bits of mantissa but a range of only about
+// 6e-8 to 65504, which is plenty for sigmoid network weights.
+
+inline std::uint32_t floatBits(const float& value) {
+    std::uint32_t bits;
+    std::memcpy(&bits, &value, sizeof(bits));
+    return bits;
+}
+
+inline float bitsFloat(const std::uint32_t& bits) {
+    float value;
+    std::memcpy(&value, &bits, sizeof(value));
+    return value;
+}
+
+struct bfloat16 {
+    std::uint16_t bits;
+
+    static constexpr const char* name = "bfloat16";
+    static constexpr const char* extension = "rbm";
+
+    static bfloat16 fromFloat(const float& value) {
+        const auto bits = floatBits(value);
+        if(std::isnan(value)) {
+            return { std::uint16_t((bits >> 16) | 0x40) };
+        }
+        return { std::uint16_t((bits + 0x7fff + ((bits >> 16) & 1)) >> 16) };
+    }
+
+    static float toFloat(const bfloat16& value) {
+        return bitsFloat(std::uint32_t(value.bits) << 16);
+    }
+};
+
+struct float16 {
+    std::uint16_t bits;
+
+    static constexpr const char* name = "float16";
+    static constexpr const char* extension = "rhm";
+
+    // Branch free conversions that let the float unit do the rounding:
+    // scaling by 2^112 and back pushes the bits that do not fit a half out
+    // of the mantissa, and subnormals come out of an add against a bias.
+    static float16 fromFloat(const float& value) {
+        float base = (std::fabs(value) * 0x1.0p+112f) * 0x1.0p-110f;
+        const std::uint32_t w = floatBits(value);
+        const std::uint32_t shl1 = w + w;
+        const std::uint32_t sign = w & 0x80000000u;
+        std::uint32_t bias = shl1 & 0xff000000u;
+        if(bias < 0x71000000u) {
+            bias = 0x71000000u;
+        }
+        base = bitsFloat((bias >> 1) + 0x07800000u) + base;
+        const std::uint32_t bits = floatBits(base);
+        const std::uint32_t nonsign = ((bits >> 13) & 0x7c00u) + (bits & 0x0fffu);
+        return { std::uint16_t((sign >> 16) | (shl1 > 0xff000000u? 0x7e00u: nonsign)) };
+    }
+
+    static float toFloat(const float16& value) {
+        const std::uint32_t w = std::uint32_t(value.bits) << 16;
+        const std::uint32_t sign = w & 0x80000000u;
+        const std::uint32_t twice = w + w;
+        const float normalized = bitsFloat((twice >> 4) + (0xe0u << 23)) * 0x1.0p-112f;
+        const float denormalized = bitsFloat((twice >> 17) | (126u << 23)) - 0.5f;
+        return bitsFloat(sign | floatBits((twice < (1u << 27))? denormalized: normalized));
+    }
+};
+
+// Rows [first, last) of y = a * x for a (rows x k) half matrix, widened to
+// float as it is read and summed in float. Four rows at a time so the
+// input is loaded once for all of them.
+template<typename H>
+void gemvWidenPortable(const int& first, const int& last, const int& k, const H* a, const int& lda, const float* x, float* y) {
+    int i = first;
+    for(; i+4<=last; i+=4) {
+        const H* a0 = a + i*lda;
+        const H* a1 = a0 + lda;
+        const H* a2 = a1 + lda;
+        const H* a3 = a2 + lda;
+        float s0 = 0, s1 = 0, s2 = 0, s3 = 0;
+        for(int p=0; p<k; ++p) {
+            s0 += H::toFloat(a0[p]) * x[p];
+            s1 += H::toFloat(a1[p]) * x[p];
+            s2 += H::toFloat(a2[p]) * x[p];
+            s3 += H::toFloat(a3[p]) * x[p];
+        }
+        y[i] = s0;
+        y[i+1] = s1;
+        y[i+2] = s2;
+        y[i+3] = s3;
+    }
+    for(; i<last; ++i) {
+        float sum = 0;
+        for(int p=0; p<k; ++p) {
+            sum += H::toFloat(a[i*lda + p]) * x[p];
+        }
+        y[i] = sum;
+    }
+}
+
+#if defined(__x86_64__)
+#define HALF_SIMD __attribute__((target("avx2,fma,f16c")))
+
+// Eight weights widened to float: vcvtph2ps for IEEE half, and a zero
+// extend plus shift for bfloat16.
+HALF_SIMD inline __m256 widen8(const float16* p) {
+    return _mm256_cvtph_ps(_mm_loadu_si128((const __m128i*)p));
+}
+
+HALF_SIMD inline __m256 widen8(const bfloat16* p) {
+    return _mm256_castsi256_ps(_mm256_slli_epi32(_mm256_cvtepu16_epi32(_mm_loadu_si128((const __m128i*)p)), 16));
+}
+
+HALF_SIMD inline float horizontalSum(const __m256& value) {
+    __m128 sum = _mm_add_ps(_mm256_castps256_ps128(value), _mm256_extractf128_ps(value, 1));
+    sum = _mm_add_ps(sum, _mm_movehl_ps(sum, sum));
+    sum = _mm_add_ss(sum, _mm_movehdup_ps(sum));
+    return _mm_cvtss_f32(sum);
+}
+
+template<typename H>
+HALF_SIMD void gemvWidenSimd(const int& first, const int& last, const int& k, const H* a, const int& lda, const float* x, float* y) {
+    const int vectorK = k & ~7;
+    auto tail = [&](const H* row, float sum) {
+        for(int p=vectorK; p<k; ++p) {
+            sum += H::toFloat(row[p]) * x[p];
+        }
+        return sum;
+    };
+
+    int i = first;
+    for(; i+4<=last; i+=4) {
+        const H* a0 = a + i*lda;
+        const H* a1 = a0 + lda;
+        const H* a2 = a1 + lda;
+        const H* a3 = a2 + lda;
+        __m256 s0 = _mm256_setzero_ps(), s1 = _mm256_setzero_ps(), s2 = _mm256_setzero_ps(), s3 = _mm256_setzero_ps();
+        for(int p=0; p<vectorK; p+=8) {
+            const __m256 v = _mm256_loadu_ps(x + p);
+            s0 = _mm256_fmadd_ps(widen8(a0 + p), v, s0);
+            s1 = _mm256_fmadd_ps(widen8(a1 + p), v, s1);
+            s2 = _mm256_fmadd_ps(widen8(a2 + p), v, s2);
+            s3 = _mm256_fmadd_ps(widen8(a3 + p), v, s3);
+        }
+        y[i] = tail(a0, horizontalSum(s0));
+        y[i+1] = tail(a1, horizontalSum(s1));
+        y[i+2] = tail(a2, horizontalSum(s2));
+        y[i+3] = tail(a3, horizontalSum(s3));
+    }
+    for(; i<last; ++i) {
+        const H* row = a + i*lda;
+        __m256 sum = _mm256_setzero_ps();
+        for(int p=0; p<vectorK; p+=8) {
+            sum = _mm256_fmadd_ps(widen8(row + p), _mm256_loadu_ps(x + p), sum);
+        }
+        y[i] = tail(row, horizontalSum(sum));
+    }
+}
+
+#undef HALF_SIMD
+#endif
+
+// y(rows) = a(rows x k) * x(k). Uses the AVX2/F16C path when the CPU has
+// it, decided once at startup, and the portable loop otherwise.
+template<typename H>
+void gemvWiden(const int& rows, const int& k, const H* a, const int& lda, const float* x, float* y) {
+#if defined(__x86_64__)
+    static const bool simd = __builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma") && __builtin_cpu_supports("f16c");
+#else
+    static const bool simd = false;
+#endif
+    parallel_for(0, rows, rowGrain(rows, k), [=](const int& first, const int& last) {
+        PROFILE_SCOPE("dotHalf");
+#if defined(__x86_64__)
+        if(simd) {
+            gemvWidenSimd(first, last, k, a, lda, x, y);
+            return;
+        }
+#endif
+        gemvWidenPortable(first, last, k, a, lda, x, y);
+    });
+}
+
+#endif
@@ -0,0 +1,149 @@
+#ifndef HALF_DNN_HPP
+#define HALF_DNN_HPP
+
+#include "halfDnnModel.hpp"
+#include "matrixView.hpp"
+#include <cmath>
+#include <vector>
+
+// A dense network whose forward pass reads 16 bit weights. Single sample
+// queries are bound by weight traffic, and two bytes per weight is a
+// quarter of what DNN streams. Activations and sums stay in float.
+//
+// Training keeps float master weights: the update goes into the masters
+// and the layer is rounded back to 16 bits afterwards, so steps smaller
+// than a half ulp still add up instead of being rounded away.
+template<typename H>
+class HalfDNN {
+public:
+    HalfDNN(const DnnModel& model)
+    :   m_learningRate(model.m_learningRate) {
+        for(const auto& weight: model.m_weights) {
+            Matrix<float> master(weight.getRows(), weight.getCols());
+            std::copy(weight.data(), weight.data() + weight.getRows()*weight.getCols(), master.data());
+            m_masters.push_back(master);
+        }
+        initialise();
+    }
+
+    HalfDNN(const HalfDnnModel<H>& model)
+    :   m_learningRate(model.m_learningRate) {
+        for(const auto& layer: model.m_layers) {
+            m_masters.push_back(layer.template widen<float>());
+        }
+        initialise();
+    }
+
+    void setLearningRate(const double& lr) {
+        m_learningRate = lr;
+    }
+
+    double getError() const {
+        double error = 0;
+        for(const auto& value: m_error) {
+            error += double(value) * value;
+        }
+        return sqrt(error/m_error.size());
+    }
+
+    // input_list is (inputs x 1); the result is (outputs x 1).
+    const Matrix<double>& query(const ConstMatrixView<double>& input_list) {
+        PROFILE_SCOPE("queryHalf");
+        forward(input_list);
+        const auto& output = m_outputs.back();
+        std::copy(output.begin(), output.end(), m_result.data());
+        return m_result;
+    }
+
+    void train(const ConstMatrixView<double>& input_list, const ConstMatrixView<double>& target_list) {
+        forward(input_list);
+
+        const auto& output = m_outputs.back();
+        for(int j=0; j<output.size(); ++j) {
+            m_error[j] = target_list(j, 0) - output[j];
+        }
+
+        std::vector<float> error = m_error, delta;
+        const float rate = m_learningRate;
+        for(int i=m_masters.size()-1; i>=0; --i) {
+            auto& master = m_masters[i];
+            const int rows = master.getRows(), cols = master.getCols();
+            const float* input = (i > 0)? m_outputs[i-1].data(): m_input.data();
+
+            delta.resize(rows);
+            for(int j=0; j<rows; ++j) {
+                delta[j] = error[j] * m_outputs[i][j] * (1.0f - m_outputs[i][j]);
+            }
+            gemmNT<float>(rows, cols, 1, rate, delta.data(), 1, input, 1, master.data(), cols, true);
+            if(i > 0) {
+                error.resize(cols);
+                gemmTN<float>(cols, 1, rows, 1.0f, master.data(), cols, delta.data(), 1, error.data(), 1, false);
+            }
+            auto& weight = m_weights[i].values;
+            for(std::size_t j=0; j<weight.size(); ++j) {
+                weight[j] = H::fromFloat(master.data()[j]);
+            }
+        }
+    }
+
+    DnnModel getModel() const {
+        DnnModel model{m_learningRate, {}};
+        for(const auto& master: m_masters) {
+            Matrix<double> weight(master.getRows(), master.getCols());
+            std::copy(master.data(), master.data() + master.getRows()*master.getCols(), weight.data());
+            model.m_weights.push_back(weight);
+        }
+        return model;
+    }
+
+    HalfDnnModel<H> getHalfModel() const {
+        HalfDnnModel<H> model;
+        model.m_learningRate = m_learningRate;
+        model.m_layers = m_weights;
+        return model;
+    }
+
+    long getWeightBytes() const {
+        return getHalfModel().getWeightBytes();
+    }
+private:
+    void initialise() {
+        for(const auto& master: m_masters) {
+            m_weights.emplace_back(master);
+            m_outputs.emplace_back(master.getRows());
+        }
+        m_input.resize(m_masters.front().getCols());
+        m_error.resize(m_masters.back().getRows());
+        m_result = Matrix<double>(m_masters.back().getRows(), 1);
+    }
+
+    void forward(const ConstMatrixView<double>& input_list) {
+        if(input_list.getRows() != m_input.size() || input_list.getCols() != 1) {
+            throw std::length_error("mismatched matrix for dot product. Dimensions not correct\n");
+        }
+        for(int j=0; j<m_input.size(); ++j) {
+            m_input[j] = input_list(j, 0);
+        }
+
+        const float* input = m_input.data();
+        for(int i=0; i<m_weights.size(); ++i) {
+            const auto& weight = m_weights[i];
+            auto& output = m_outputs[i];
+            gemvWiden(weight.rows, weight.cols, weight.values.data(), weight.cols, input, output.data());
+            for(auto& value: output) {
+                value = 1 / (1 + std::exp(-value));
+            }
+            input = output.data();
+        }
+    }
+private:
+    double m_learningRate;
+    std::vector<Matrix<float>> m_masters;
+    std::vector<HalfMatrix<H>> m_weights;
+    std::vector<float> m_input;
+    std::vector<std::vector<float>> m_outputs;
+    std::vector<float> m_error;
+    Matrix<double> m_result;
+};
+
+#endif
@@ -0,0 +1,127 @@
+#ifndef HALF_DNN_MODEL_HPP
+#define HALF_DNN_MODEL_HPP
+
+#include "half.hpp"
+#include "dnnModel.hpp"
+#include <vector>
+#include <fstream>
+
+// A (rows x cols) row major matrix of 16 bit weights.
+template<typename H>
+struct HalfMatrix {
+    int rows = 0;
+    int cols = 0;
+    std::vector<H> values;
+
+    HalfMatrix() {}
+
+    template<typename T>
+    HalfMatrix(const Matrix<T>& mat)
+    :   rows(mat.getRows()),
+        cols(mat.getCols()),
+        values(std::size_t(rows) * cols) {
+        for(std::size_t i=0; i<values.size(); ++i) {
+            values[i] = H::fromFloat(mat.data()[i]);
+        }
+    }
+
+    template<typename T>
+    Matrix<T> widen() const {
+        Matrix<T> mat(rows, cols);
+        for(std::size_t i=0; i<values.size(); ++i) {
+            mat.data()[i] = H::toFloat(values[i]);
+        }
+        return mat;
+    }
+};
+
+// A dense model with 16 bit weights. Saved as .rbm for bfloat16 and .rhm
+// for IEEE half; the layout is the .rwm one with two bytes per weight.
+template<typename H>
+struct HalfDnnModel {
+
+    HalfDnnModel() {}
+
+    HalfDnnModel(const DnnModel& model)
+    :   m_learningRate(model.m_learningRate) {
+        for(const auto& weight: model.m_weights) {
+            m_layers.emplace_back(weight);
+        }
+    }
+
+    DnnModel toDense() const {
+        DnnModel model{m_learningRate, {}};
+        for(const auto& layer: m_layers) {
+            model.m_weights.push_back(layer.template widen<double>());
+        }
+        return model;
+    }
+
+    long getWeightBytes() const {
+        long bytes = 0;
+        for(const auto& layer: m_layers) {
+            bytes += layer.values.size() * sizeof(H);
+        }
+        return bytes;
+    }
+
+    void saveModel(const std::string& fileName) const {
+        auto index = fileName.find_last_of('.');
+        auto extension = fileName.substr(index+1);
+        if(extension == H::extension) {
+            saveRawModel(fileName);
+        } else {
+            throw std::invalid_argument(extension + ": no file format for extension");
+        }
+    }
+
+    static auto loadModel(const std::string& fileName) {
+        auto index = fileName.find_last_of('.');
+        auto extension = fileName.substr(index+1);
+        if(extension == H::extension) {
+            return loadRawModel(fileName);
+        } else {
+            throw std::invalid_argument(extension + ": no file format for extension");
+        }
+    }
+
+private:
+    void saveRawModel(const std::string& fileName) const {
+        std::ofstream file(fileName, std::ios::binary);
+        file.exceptions(std::ios::failbit | std::ios::badbit);
+
+        file.write((char*)&m_learningRate, sizeof(m_learningRate));
+        int size = m_layers.size();
+        file.write((char*)&size, sizeof(size));
+
+        for(const auto& layer: m_layers) {
+            file.write((char*)&layer.rows, sizeof(layer.rows));
+            file.write((char*)&layer.cols, sizeof(layer.cols));
+            file.write((char*)layer.values.data(), sizeof(H) * layer.values.size());
+        }
+    }
+
+    static HalfDnnModel loadRawModel(const std::string& fileName) {
+        std::ifstream file(fileName, std::ios::binary);
+        file.exceptions(std::ios::failbit | std::ios::badbit);
+
+        HalfDnnModel model;
+        file.read((char*)&model.m_learningRate, sizeof(model.m_learningRate));
+        int layerCount;
+        file.read((char*)&layerCount, sizeof(layerCount));
+        for(int i=0; i<layerCount; ++i) {
+            HalfMatrix<H> layer;
+            file.read((char*)&layer.rows, sizeof(layer.rows));
+            file.read((char*)&layer.cols, sizeof(layer.cols));
+            layer.values.resize(std::size_t(layer.rows) * layer.cols);
+            file.read((char*)layer.values.data(), sizeof(H) * layer.values.size());
+            model.m_layers.push_back(std::move(layer));
+        }
+        return model;
+    }
+public:
+    double m_learningRate;
+    std::vector<HalfMatrix<H>> m_layers;
+};
+
+#endif
@@ -0,0 +1,52 @@
+#ifndef IMAGE_HPP
+#define IMAGE_HPP
+
+#include "matrix.hpp"
+#include <vector>
+#include <string>
+#include <fstream>
+#include <algorithm>
+
+inline void savePgm(const std::string& fileName, const std::vector<unsigned char>& pixels, const int& width, const int& height) {
+    std::ofstream file(fileName, std::ios::binary);
+    file.exceptions(std::ios::failbit | std::ios::badbit);
+
+    file << "P5\n" << width << ' ' << height << "\n255\n";
+    file.write((const char*)pixels.data(), pixels.size());
+}
+
+// Every column of images is one side x side image, stored row major the
+// same way as MnistData::pixels. Each image is stretched to the full grey
+// range on its own because reverse queries are not bounded to [0, 1].
+template<typename T>
+void saveImageSheet(const std::string& fileName, const Matrix<T>& images, const int& side, const int& tilesPerRow) {
+    if(images.getRows() != side*side) {
+        throw std::length_error("image columns do not match the tile size");
+    }
+
+    const int count = images.getCols();
+    const int tileRows = (count + tilesPerRow - 1) / tilesPerRow;
+    const int width = tilesPerRow * side;
+    std::vector<unsigned char> sheet(width * tileRows * side);
+
+    for(int n=0; n<count; ++n) {
+        T low = images[0][n], high = images[0][n];
+        for(int p=1; p<side*side; ++p) {
+            low = std::min(low, images[p][n]);
+            high = std::max(high, images[p][n]);
+        }
+        const T scale = (high > low)? 255 / (high - low): 0;
+
+        const int top = (n / tilesPerRow) * side;
+        const int left = (n % tilesPerRow) * side;
+        for(int y=0; y<side; ++y) {
+            for(int x=0; x<side; ++x) {
+                sheet[(top + y)*width + left + x] = (unsigned char)((images[y*side + x][n] - low) * scale);
+            }
+        }
+    }
+
+    savePgm(fileName, sheet, width, tileRows * side);
+}
+
+#endif
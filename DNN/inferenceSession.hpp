@@ -0,0 +1,114 @@
+#ifndef INFERENCE_SESSION_HPP
+#define INFERENCE_SESSION_HPP
+
+#include "matrixView.hpp"
+#include "activation.hpp"
+#include "dnnModel.hpp"
+#include "scheduler.hpp"
+#include <vector>
+#include <algorithm>
+#include <stdexcept>
+
+// Read-only view of a trained dense network that any number of threads can
+// query at once. The session owns the only copy of the weights and never
+// writes to itself after construction; everything a query writes lives in
+// a Context, which each calling thread keeps for itself.
+class InferenceSession {
+public:
+    // Scratch space for one thread: two activation buffers that the layers
+    // ping-pong between. Grows to the largest batch it has seen.
+    //
+    // A serial context runs each query entirely on the calling thread, so
+    // concurrent callers never meet in the scheduler; that is what a
+    // server thread wants. A context that is not serial splits large
+    // batches over the scheduler's workers instead.
+    class Context {
+    public:
+        Context(const bool& serial = true)
+        :   m_serial(serial) {}
+    private:
+        friend class InferenceSession;
+        bool m_serial;
+        std::vector<double> m_buffers[2];
+    };
+
+    InferenceSession(const DnnModel& model)
+    :   m_weights(model.m_weights) {
+
+        if(m_weights.empty()) {
+            throw std::length_error("Network needs atleast two layers.");
+        }
+        for(int i=0; i<m_weights.size(); ++i) {
+            if(i > 0 && m_weights[i].getCols() != m_weights[i-1].getRows()) {
+                throw std::length_error("mismatched layer sizes in model");
+            }
+            m_widest = std::max(m_widest, m_weights[i].getRows());
+        }
+    }
+
+    InferenceSession(const InferenceSession&) = delete;
+    InferenceSession& operator=(const InferenceSession&) = delete;
+
+    int getInputs() const {
+        return m_weights.front().getCols();
+    }
+
+    int getOutputs() const {
+        return m_weights.back().getRows();
+    }
+
+    // Inputs are (inputs x batch), one sample per column. The result is
+    // (outputs x batch) and stays valid until the context is used again.
+    ConstMatrixView<double> query(Context& context, const ConstMatrixView<double>& input) const {
+        if(input.getRows() != getInputs()) {
+            throw std::length_error("mismatched matrix for dot product. Dimensions not correct\n");
+        }
+
+        SerialRegion serial(context.m_serial);
+        const int batch = input.getCols();
+        for(auto& buffer: context.m_buffers) {
+            if(buffer.size() < std::size_t(m_widest) * batch) {
+                buffer.resize(std::size_t(m_widest) * batch);
+            }
+        }
+
+        ConstMatrixView<double> in = input;
+        for(int i=0; i<m_weights.size(); ++i) {
+            const auto& weight = m_weights[i];
+            MatrixView<double> out(context.m_buffers[i % 2].data(), weight.getRows(), batch, batch);
+            gemm<double>(weight, in, out);
+
+            double* values = out.data();
+            for(int j=0; j<weight.getRows()*batch; ++j) {
+                values[j] = expit(values[j]);
+            }
+            in = out;
+        }
+        return in;
+    }
+
+    // Single sample, as a column of getOutputs() values.
+    ConstMatrixView<double> query(Context& context, const std::vector<double>& input) const {
+        return query(context, ConstMatrixView<double>(input));
+    }
+
+    // Convenience for callers that do not manage contexts: uses one
+    // context per thread and returns a copy of the outputs.
+    Matrix<double> query(const ConstMatrixView<double>& input) const {
+        thread_local Context context;
+        return query(context, input).copy();
+    }
+
+    std::size_t getWeightBytes() const {
+        std::size_t bytes = 0;
+        for(const auto& weight: m_weights) {
+            bytes += sizeof(double) * weight.getRows() * weight.getCols();
+        }
+        return bytes;
+    }
+private:
+    const std::vector<Matrix<double>> m_weights;
+    int m_widest = 0;
+};
+
+#endif
@@ -0,0 +1,240 @@
+#ifndef KERNELS_HPP
+#define KERNELS_HPP
+
+#include "scheduler.hpp"
+#include "profiler.hpp"
+#include "gemmTuning.hpp"
+#include <algorithm>
+
+// Row major kernels on raw buffers. Matrix::dot, MatrixView and the
+// executor all go through these so there is a single place to tune the
+// inner loops. Every operand has its own leading dimension (the distance
+// between consecutive rows) so sub-blocks can be used without copying.
+// Output rows are split across the scheduler once a product is large
+// enough to pay for the tasks, or as the tuning cache says for shapes the
+// autotuner has measured on this machine.
+
+inline int rowGrain(const int& rows, const long& work) {
+    constexpr long minimumWork = 1 << 15;
+    if(work * rows < 2 * minimumWork) {
+        return rows;
+    }
+    return std::max<long>(1, minimumWork / std::max<long>(work, 1));
+}
+
+// The tuned configuration for a shape, or the defaults when there is none.
+inline GemmConfig gemmConfig(const GemmKernel& kernel, const int& m, const int& n, const int& k) {
+    if(auto tuned = GemmTuning::instance().find(kernel, m, n, k)) {
+        return *tuned;
+    }
+    return { rowGrain(m, long(n)*k), k, 0 };
+}
+
+// Rows [first, last) of the matrix-vector product c = alpha * a * b, or
+// += when accumulate is set. Each sum stays in a register, and four rows
+// run side by side so their independent add chains overlap; every row is
+// still summed in order, so results match the one-row loop exactly.
+template<typename T>
+void gemv(const int& first, const int& last, const int& k, const T& alpha,
+          const T* a, const int& lda, const T* b, const int& ldb, T* c, const int& ldc, const bool& accumulate) {
+    auto store = [&](const int& i, const T& sum) {
+        c[i*ldc] = (accumulate? c[i*ldc]: T()) + alpha * sum;
+    };
+
+    int i = first;
+    for(; i+4<=last; i+=4) {
+        const T* a0 = a + i*lda;
+        const T* a1 = a0 + lda;
+        const T* a2 = a1 + lda;
+        const T* a3 = a2 + lda;
+        T s0 = T(), s1 = T(), s2 = T(), s3 = T();
+        for(int p=0; p<k; ++p) {
+            const T x = b[p*ldb];
+            s0 += a0[p] * x;
+            s1 += a1[p] * x;
+            s2 += a2[p] * x;
+            s3 += a3[p] * x;
+        }
+        store(i, s0);
+        store(i+1, s1);
+        store(i+2, s2);
+        store(i+3, s3);
+    }
+    for(; i<last; ++i) {
+        T sum = T();
+        for(int p=0; p<k; ++p) {
+            sum += a[i*lda + p] * b[p*ldb];
+        }
+        store(i, sum);
+    }
+}
+
+// Rows [first, last) of the rank one product c = alpha * a * b with a
+// (m x 1) and b (1 x n), or += when accumulate is set. This is the per
+// sample weight update, profiled apart from the forward products.
+template<typename T>
+void outer(const int& first, const int& last, const int& n, const T& alpha,
+           const T* a, const int& lda, const T* b, T* c, const int& ldc, const bool& accumulate) {
+    PROFILE_SCOPE("outer");
+    for(int i=first; i<last; ++i) {
+        const T value = alpha * a[i*lda];
+        T* row = c + i*ldc;
+        for(int j=0; j<n; ++j) {
+            row[j] = (accumulate? row[j]: T()) + value * b[j];
+        }
+    }
+}
+
+// c(m x n) = alpha * a(m x k) * b(k x n), or += when accumulate is set.
+template<typename T>
+void gemmNN(const int& m, const int& n, const int& k, const T& alpha,
+            const T* a, const int& lda, const T* b, const int& ldb, T* c, const int& ldc, const bool& accumulate) {
+    const auto config = gemmConfig(GemmKernel::nn, m, n, k);
+    const int blockK = std::max(1, std::min(config.blockK, k));
+    parallel_for(0, m, std::max(1, config.grain), [=](const int& first, const int& last) {
+        if(k == 1 && n > 1) {
+            outer(first, last, n, alpha, a, lda, b, c, ldc, accumulate);
+            return;
+        }
+        PROFILE_SCOPE("dot");
+        if(n == 1) {
+            gemv(first, last, k, alpha, a, lda, b, ldb, c, ldc, accumulate);
+            return;
+        }
+        if(!accumulate) {
+            for(int i=first; i<last; ++i) {
+                std::fill(c + i*ldc, c + i*ldc + n, T());
+            }
+        }
+        auto axpy = [&](const int& i, const int& p) {
+            const T value = alpha * a[i*lda + p];
+            const T* src = b + p*ldb;
+            T* row = c + i*ldc;
+            for(int j=0; j<n; ++j) {
+                row[j] += value * src[j];
+            }
+        };
+        // Each output still sees p in increasing order whatever the
+        // blocking, so every order gives the same result.
+        for(int p0=0; p0<k; p0+=blockK) {
+            const int p1 = std::min(p0 + blockK, k);
+            if(config.order == 0) {
+                for(int i=first; i<last; ++i) {
+                    for(int p=p0; p<p1; ++p) {
+                        axpy(i, p);
+                    }
+                }
+            } else {
+                for(int p=p0; p<p1; ++p) {
+                    for(int i=first; i<last; ++i) {
+                        axpy(i, p);
+                    }
+                }
+            }
+        }
+    });
+}
+
+// c(m x n) = alpha * a^T * b where a is stored (k x m), or += when
+// accumulate is set.
+template<typename T>
+void gemmTN(const int& m, const int& n, const int& k, const T& alpha,
+            const T* a, const int& lda, const T* b, const int& ldb, T* c, const int& ldc, const bool& accumulate) {
+    const auto config = gemmConfig(GemmKernel::tn, m, n, k);
+    parallel_for(0, m, std::max(1, config.grain), [=](const int& first, const int& last) {
+        PROFILE_SCOPE("dotTransA");
+        if(!accumulate) {
+            for(int i=first; i<last; ++i) {
+                std::fill(c + i*ldc, c + i*ldc + n, T());
+            }
+        }
+        if(n == 1 && ldc == 1) {
+            // Matrix-vector: one contiguous axpy over the output per row
+            // of a, in the same order as the general loop below.
+            for(int p=0; p<k; ++p) {
+                const T x = b[p*ldb];
+                const T* src = a + p*lda;
+                for(int i=first; i<last; ++i) {
+                    c[i] += (alpha * src[i]) * x;
+                }
+            }
+            return;
+        }
+        for(int p=0; p<k; ++p) {
+            const T* src = b + p*ldb;
+            for(int i=first; i<last; ++i) {
+                const T value = alpha * a[p*lda + i];
+                T* row = c + i*ldc;
+                for(int j=0; j<n; ++j) {
+                    row[j] += value * src[j];
+                }
+            }
+        }
+    });
+}
+
+// c(m x n) = alpha * a * b^T where b is stored (n x k), or += when
+// accumulate is set.
+template<typename T>
+void gemmNT(const int& m, const int& n, const int& k, const T& alpha,
+            const T* a, const int& lda, const T* b, const int& ldb, T* c, const int& ldc, const bool& accumulate) {
+    const auto config = gemmConfig(GemmKernel::nt, m, n, k);
+    parallel_for(0, m, std::max(1, config.grain), [=](const int& first, const int& last) {
+        PROFILE_SCOPE("dotTransB");
+        for(int i=first; i<last; ++i) {
+            T* row = c + i*ldc;
+            const T* x = a + i*lda;
+            for(int j=0; j<n; ++j) {
+                const T* y = b + j*ldb;
+                T sum = T();
+                for(int p=0; p<k; ++p) {
+                    sum += x[p] * y[p];
+                }
+                row[j] = (accumulate? row[j]: T()) + alpha * sum;
+            }
+        }
+    });
+}
+
+// c(m x n) = a(m x k) * b(k x n), or += when accumulate is set.
+template<typename T>
+void gemm(const int& m, const int& n, const int& k, const T* a, const T* b, T* c, const bool& accumulate = false) {
+    gemmNN(m, n, k, T(1), a, k, b, n, c, n, accumulate);
+}
+
+// c(m x n) = a^T * b where a is (k x m).
+template<typename T>
+void gemmTransA(const int& m, const int& n, const int& k, const T* a, const T* b, T* c) {
+    gemmTN(m, n, k, T(1), a, m, b, n, c, n, false);
+}
+
+// c(m x n) += alpha * a * b^T where a is (m x k) and b is (n x k).
+template<typename T>
+void gemmTransB(const int& m, const int& n, const int& k, const T& alpha, const T* a, const T* b, T* c) {
+    gemmNT(m, n, k, alpha, a, k, b, k, c, n, true);
+}
+
+// b(cols x rows) = a(rows x cols)^T. Cache oblivious: the larger side is
+// halved until the block is at most 32x32, small enough that the strided
+// side's cache lines are all still resident when the block moves on to
+// their next elements, whatever the cache sizes are.
+template<typename T>
+void transpose(const int& rows, const int& cols, const T* a, const int& lda, T* b, const int& ldb) {
+    if(rows <= 32 && cols <= 32) {
+        for(int j=0; j<cols; ++j) {
+            for(int i=0; i<rows; ++i) {
+                b[j*ldb + i] = a[i*lda + j];
+            }
+        }
+    } else if(rows >= cols) {
+        const int half = rows / 2;
+        transpose(half, cols, a, lda, b, ldb);
+        transpose(rows - half, cols, a + half*lda, lda, b + half, ldb);
+    } else {
+        const int half = cols / 2;
+        transpose(rows, half, a, lda, b, ldb);
+        transpose(rows, cols - half, a + half, lda, b + half*ldb, ldb);
+    }
+}
+
+#endif
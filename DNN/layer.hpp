@@ -0,0 +1,243 @@
+#ifndef LAYER_HPP
+#define LAYER_HPP
+
+#include "matrix.hpp"
+#include "matrixView.hpp"
+#include "activation.hpp"
+#include "cnnModel.hpp"
+#include <vector>
+#include <chrono>
+#include <random>
+#include <cmath>
+#include <memory>
+
+// Layers work on column vectors. Images are stored channel by channel,
+// each channel row major, which is the layout of MnistData::pixels.
+class Layer {
+public:
+    virtual ~Layer() {}
+
+    virtual const Matrix<double>& forward(const Matrix<double>& input) = 0;
+
+    // Takes the error of this layer's output and returns the error of its
+    // input, updating the weights on the way.
+    virtual Matrix<double> backward(const Matrix<double>& input, const Matrix<double>& error, const double& learningRate) = 0;
+
+    virtual LayerSpec getSpec() const = 0;
+
+    const Matrix<double>& getOutput() const {
+        return m_output;
+    }
+protected:
+    static void initialize(Matrix<double>& weights, const int& nodes) {
+        auto seed = std::chrono::system_clock::now().time_since_epoch().count();
+        std::default_random_engine generator(seed);
+        std::normal_distribution<double> distribution(0.0, std::pow(nodes, -0.5));
+
+        for(int i=0; i<weights.getRows()*weights.getCols(); ++i) {
+            weights.data()[i] = distribution(generator);
+        }
+    }
+
+    Matrix<double> m_output;
+};
+
+class Dense : public Layer {
+public:
+    Dense(const LayerSpec& spec)
+    :   m_weights(spec.weights) {
+        if(spec.weights.getRows()*spec.weights.getCols() == 0) {
+            m_weights = Matrix<double>(spec.outputs, spec.channels);
+            initialize(m_weights, spec.outputs);
+        }
+    }
+
+    const Matrix<double>& forward(const Matrix<double>& input) override {
+        m_output = activate(m_weights.dot(input));
+        return m_output;
+    }
+
+    Matrix<double> backward(const Matrix<double>& input, const Matrix<double>& error, const double& learningRate) override {
+        auto delta = error * m_output * (1.0 - m_output);
+        auto inputError = dot<double>(ConstMatrixView<double>(m_weights).transpose(), delta);
+        gemm<double>(delta, ConstMatrixView<double>(input).transpose(), m_weights, learningRate, true);
+        return inputError;
+    }
+
+    LayerSpec getSpec() const override {
+        auto spec = LayerSpec::dense(m_weights.getCols(), m_weights.getRows());
+        spec.weights = m_weights;
+        return spec;
+    }
+private:
+    Matrix<double> m_weights;
+};
+
+// Convolution lowered to Matrix::dot: im2col unrolls every receptive field
+// into a column of m_columns so the whole layer is one product with the
+// (outputs x channels*kernel*kernel) weight matrix. m_columns and
+// m_inputError are kept between calls and only rewritten.
+class Conv2D : public Layer {
+public:
+    Conv2D(const LayerSpec& spec)
+    :   m_spec(spec),
+        m_outHeight((spec.height + 2*spec.padding - spec.kernel) / spec.stride + 1),
+        m_outWidth((spec.width + 2*spec.padding - spec.kernel) / spec.stride + 1),
+        m_weights(spec.weights),
+        m_columns(spec.channels*spec.kernel*spec.kernel, m_outHeight*m_outWidth),
+        m_inputError(spec.channels*spec.height*spec.width, 1) {
+
+        if(m_outHeight < 1 || m_outWidth < 1) {
+            throw std::length_error("convolution kernel larger than its input");
+        }
+        if(spec.weights.getRows()*spec.weights.getCols() == 0) {
+            m_weights = Matrix<double>(spec.outputs, spec.channels*spec.kernel*spec.kernel);
+            initialize(m_weights, spec.channels*spec.kernel*spec.kernel);
+        }
+        m_spec.weights = Matrix<double>(0, 0);
+    }
+
+    const int& getOutHeight() const {
+        return m_outHeight;
+    }
+
+    const int& getOutWidth() const {
+        return m_outWidth;
+    }
+
+    const Matrix<double>& forward(const Matrix<double>& input) override {
+        im2col(input);
+        m_output = activate(m_weights.dot(m_columns));
+        m_output.reshape(m_spec.outputs*m_outHeight*m_outWidth, 1);
+        return m_output;
+    }
+
+    Matrix<double> backward(const Matrix<double>&, const Matrix<double>& error, const double& learningRate) override {
+        auto delta = error * m_output * (1.0 - m_output);
+        delta.reshape(m_spec.outputs, m_outHeight*m_outWidth);
+
+        col2im(dot<double>(ConstMatrixView<double>(m_weights).transpose(), delta));
+        gemm<double>(delta, ConstMatrixView<double>(m_columns).transpose(), m_weights, learningRate, true);
+        return m_inputError;
+    }
+
+    LayerSpec getSpec() const override {
+        auto spec = m_spec;
+        spec.weights = m_weights;
+        return spec;
+    }
+private:
+    template<typename F>
+    void forEachTap(F&& f) const {
+        const int k = m_spec.kernel;
+        for(int c=0; c<m_spec.channels; ++c) {
+            for(int ky=0; ky<k; ++ky) {
+                for(int kx=0; kx<k; ++kx) {
+                    const int row = (c*k + ky)*k + kx;
+                    for(int oy=0; oy<m_outHeight; ++oy) {
+                        const int iy = oy*m_spec.stride - m_spec.padding + ky;
+                        for(int ox=0; ox<m_outWidth; ++ox) {
+                            const int ix = ox*m_spec.stride - m_spec.padding + kx;
+                            const bool inside = iy >= 0 && iy < m_spec.height && ix >= 0 && ix < m_spec.width;
+                            f(row, oy*m_outWidth + ox, inside? (c*m_spec.height + iy)*m_spec.width + ix: -1);
+                        }
+                    }
+                }
+            }
+        }
+    }
+
+    void im2col(const Matrix<double>& input) {
+        const double* in = input.data();
+        double* columns = m_columns.data();
+        const int width = m_columns.getCols();
+        forEachTap([&](const int& row, const int& col, const int& pixel) {
+            columns[row*width + col] = (pixel < 0)? 0: in[pixel];
+        });
+    }
+
+    void col2im(const Matrix<double>& columnError) {
+        const double* columns = columnError.data();
+        double* out = m_inputError.data();
+        const int width = columnError.getCols();
+        std::fill(out, out + m_inputError.getRows(), 0.0);
+        forEachTap([&](const int& row, const int& col, const int& pixel) {
+            if(pixel >= 0) {
+                out[pixel] += columns[row*width + col];
+            }
+        });
+    }
+private:
+    LayerSpec m_spec;
+    int m_outHeight, m_outWidth;
+    Matrix<double> m_weights;
+    Matrix<double> m_columns;
+    Matrix<double> m_inputError;
+};
+
+class MaxPool2D : public Layer {
+public:
+    MaxPool2D(const LayerSpec& spec)
+    :   m_spec(spec),
+        m_outHeight(spec.height / spec.kernel),
+        m_outWidth(spec.width / spec.kernel),
+        m_argmax(spec.channels*m_outHeight*m_outWidth),
+        m_inputError(spec.channels*spec.height*spec.width, 1) {
+        m_output = Matrix<double>(spec.channels*m_outHeight*m_outWidth, 1);
+    }
+
+    const Matrix<double>& forward(const Matrix<double>& input) override {
+        const double* in = input.data();
+        double* out = m_output.data();
+        const int size = m_spec.kernel;
+
+        for(int c=0; c<m_spec.channels; ++c) {
+            for(int oy=0; oy<m_outHeight; ++oy) {
+                for(int ox=0; ox<m_outWidth; ++ox) {
+                    int best = (c*m_spec.height + oy*size)*m_spec.width + ox*size;
+                    for(int y=0; y<size; ++y) {
+                        for(int x=0; x<size; ++x) {
+                            const int pixel = (c*m_spec.height + oy*size + y)*m_spec.width + ox*size + x;
+                            if(in[pixel] > in[best]) {
+                                best = pixel;
+                            }
+                        }
+                    }
+                    const int index = (c*m_outHeight + oy)*m_outWidth + ox;
+                    m_argmax[index] = best;
+                    out[index] = in[best];
+                }
+            }
+        }
+        return m_output;
+    }
+
+    Matrix<double> backward(const Matrix<double>&, const Matrix<double>& error, const double&) override {
+        double* out = m_inputError.data();
+        std::fill(out, out + m_inputError.getRows(), 0.0);
+        for(int i=0; i<m_argmax.size(); ++i) {
+            out[m_argmax[i]] += error.data()[i];
+        }
+        return m_inputError;
+    }
+
+    LayerSpec getSpec() const override {
+        return m_spec;
+    }
+private:
+    LayerSpec m_spec;
+    int m_outHeight, m_outWidth;
+    std::vector<int> m_argmax;
+    Matrix<double> m_inputError;
+};
+
+inline std::unique_ptr<Layer> makeLayer(const LayerSpec& spec) {
+    switch(spec.type) {
+        case LayerType::Dense: return std::make_unique<Dense>(spec);
+        case LayerType::Conv2D: return std::make_unique<Conv2D>(spec);
+        case LayerType::MaxPool2D: return std::make_unique<MaxPool2D>(spec);
+    }
+    throw std::invalid_argument("unknown layer type");
+}
+
+#endif
@@ -0,0 +1,150 @@
+#ifndef LOW_RANK_HPP
+#define LOW_RANK_HPP
+
+#include "matrix.hpp"
+#include "matrixView.hpp"
+#include <vector>
+#include <random>
+#include <algorithm>
+#include <numeric>
+#include <cmath>
+#include <stdexcept>
+
+// Truncated singular value decomposition a ~= u * diag(s) * vt with the
+// singular values in descending order.
+struct Svd {
+    Matrix<double> u;
+    std::vector<double> s;
+    Matrix<double> vt;
+};
+
+// Orthonormalizes the columns of mat in place (modified Gram-Schmidt).
+// Columns that are numerically dependent on the earlier ones become zero.
+inline void orthonormalize(Matrix<double>& mat) {
+    auto columns = mat.transpose();
+    const int n = columns.getCols();
+    for(int i=0; i<columns.getRows(); ++i) {
+        double* row = columns.data() + i*n;
+        for(int j=0; j<i; ++j) {
+            const double* previous = columns.data() + j*n;
+            const double projection = std::inner_product(row, row + n, previous, 0.0);
+            for(int k=0; k<n; ++k) {
+                row[k] -= projection * previous[k];
+            }
+        }
+        const double norm = std::sqrt(std::inner_product(row, row + n, row, 0.0));
+        for(int k=0; k<n; ++k) {
+            row[k] = (norm > 1e-12)? row[k] / norm: 0.0;
+        }
+    }
+    mat = columns.transpose();
+}
+
+// Eigen decomposition of a small symmetric matrix by cyclic Jacobi
+// rotations. Returns the eigenvalues in descending order and overwrites
+// vectors with the matching eigenvectors as columns.
+inline std::vector<double> symmetricEigen(Matrix<double> a, Matrix<double>& vectors) {
+    const int n = a.getRows();
+    vectors = Matrix<double>::identity(n, n);
+
+    for(int sweep=0; sweep<64; ++sweep) {
+        double off = 0;
+        for(int p=0; p<n; ++p) {
+            for(int q=p+1; q<n; ++q) {
+                off += a[p][q] * a[p][q];
+            }
+        }
+        if(off < 1e-22) {
+            break;
+        }
+
+        for(int p=0; p<n; ++p) {
+            for(int q=p+1; q<n; ++q) {
+                if(std::abs(a[p][q]) < 1e-300) {
+                    continue;
+                }
+                const double theta = (a[q][q] - a[p][p]) / (2 * a[p][q]);
+                const double t = (theta >= 0? 1.0: -1.0) / (std::abs(theta) + std::sqrt(theta*theta + 1));
+                const double c = 1 / std::sqrt(t*t + 1), s = t * c;
+
+                for(int k=0; k<n; ++k) {
+                    const double akp = a[k][p], akq = a[k][q];
+                    a[k][p] = c*akp - s*akq;
+                    a[k][q] = s*akp + c*akq;
+                }
+                for(int k=0; k<n; ++k) {
+                    const double apk = a[p][k], aqk = a[q][k];
+                    a[p][k] = c*apk - s*aqk;
+                    a[q][k] = s*apk + c*aqk;
+                }
+                for(int k=0; k<n; ++k) {
+                    const double vkp = vectors[k][p], vkq = vectors[k][q];
+                    vectors[k][p] = c*vkp - s*vkq;
+                    vectors[k][q] = s*vkp + c*vkq;
+                }
+            }
+        }
+    }
+
+    std::vector<int> order(n);
+    std::iota(order.begin(), order.end(), 0);
+    std::sort(order.begin(), order.end(), [&](const int& x, const int& y) { return a[x][x] > a[y][y]; });
+
+    std::vector<double> values(n);
+    Matrix<double> sorted(n, n);
+    for(int j=0; j<n; ++j) {
+        values[j] = a[order[j]][order[j]];
+        for(int i=0; i<n; ++i) {
+            sorted[i][j] = vectors[i][order[j]];
+        }
+    }
+    vectors = sorted;
+    return values;
+}
+
+// Randomized SVD (Halko, Martinsson and Tropp): sketch the range of a with
+// rank + oversample gaussian probes, sharpen it with a few power
+// iterations, then take an exact SVD of the small projected matrix.
+inline Svd randomizedSvd(const Matrix<double>& a, const int& rank, const int& oversample = 10, const int& iterations = 2, const unsigned& seed = 42) {
+    const int m = a.getRows(), n = a.getCols();
+    if(rank < 1 || rank > std::min(m, n)) {
+        throw std::invalid_argument("rank must be in the range [1, min(rows, cols)]");
+    }
+    const int l = std::min(rank + oversample, std::min(m, n));
+
+    std::mt19937 generator(seed);
+    std::normal_distribution<double> distribution(0.0, 1.0);
+    Matrix<double> omega(n, l);
+    for(int i=0; i<n; ++i) {
+        for(int j=0; j<l; ++j) {
+            omega[i][j] = distribution(generator);
+        }
+    }
+
+    const ConstMatrixView<double> at = ConstMatrixView<double>(a).transpose();
+    auto q = dot<double>(a, omega);
+    for(int i=0; i<iterations; ++i) {
+        orthonormalize(q);
+        auto z = dot<double>(at, q);
+        orthonormalize(z);
+        q = dot<double>(a, z);
+    }
+    orthonormalize(q);
+
+    // a ~= q * b with b small (l x n); b * b^T = ub * s^2 * ub^T.
+    const auto b = dot<double>(ConstMatrixView<double>(q).transpose(), a);
+    Matrix<double> ub;
+    const auto values = symmetricEigen(dot<double>(b, ConstMatrixView<double>(b).transpose()), ub);
+
+    const ConstMatrixView<double> leading = ConstMatrixView<double>(ub).block(0, 0, l, rank);
+    Svd svd{ dot<double>(q, leading), std::vector<double>(rank), dot<double>(leading.transpose(), b) };
+    for(int i=0; i<rank; ++i) {
+        svd.s[i] = std::sqrt(std::max(values[i], 0.0));
+        for(int j=0; j<n; ++j) {
+            svd.vt[i][j] = (svd.s[i] > 1e-12)? svd.vt[i][j] / svd.s[i]: 0.0;
+        }
+    }
+    return svd;
+}
+
+#endif
@@ -0,0 +1,37 @@
+#ifndef LOW_RANK_DNN_HPP
+#define LOW_RANK_DNN_HPP
+
+#include "lowRankDnnModel.hpp"
+#include "activation.hpp"
+#include <vector>
+
+// Forward pass over a factorized model. A factorized layer runs as two
+// thin products, right then left, and only the outer one is activated.
+class LowRankDNN {
+public:
+    LowRankDNN(const LowRankDnnModel& model)
+    :   m_layers(model.m_layers),
+        m_outputs(model.m_layers.size()) {}
+
+    const Matrix<double>& query(const ConstMatrixView<double>& input_list) {
+        ConstMatrixView<double> input = input_list;
+        for(int i=0; i<m_layers.size(); ++i) {
+            const auto& layer = m_layers[i];
+            if(layer.rank) {
+                m_projected = dot<double>(layer.right, input);
+                m_outputs[i] = activate(layer.left.dot(m_projected));
+            } else {
+                m_outputs[i] = activate(dot<double>(layer.left, input));
+            }
+            input = m_outputs[i];
+        }
+
+        return m_outputs.back();
+    }
+private:
+    std::vector<LowRankLayer> m_layers;
+    std::vector<Matrix<double>> m_outputs;
+    Matrix<double> m_projected;
+};
+
+#endif
@@ -0,0 +1,145 @@
+#ifndef LOW_RANK_DNN_MODEL_HPP
+#define LOW_RANK_DNN_MODEL_HPP
+
+#include "lowRank.hpp"
+#include "dnnModel.hpp"
+#include <vector>
+#include <fstream>
+
+// One layer of a factorized network. A rank of zero keeps the layer dense
+// in left; otherwise weight ~= left (rows x rank) * right (rank x cols).
+struct LowRankLayer {
+    int rank;
+    Matrix<double> left;
+    Matrix<double> right;
+
+    long getFlops() const {
+        return rank? 2L * rank * (left.getRows() + right.getCols()): 2L * left.getRows() * left.getCols();
+    }
+
+    Matrix<double> toDense() const {
+        return rank? left.dot(right): left;
+    }
+};
+
+struct LowRankDnnModel {
+
+    LowRankDnnModel() {}
+
+    // ranks[i] == 0 leaves layer i dense.
+    LowRankDnnModel(const DnnModel& model, const std::vector<int>& ranks)
+    :   m_learningRate(model.m_learningRate) {
+
+        if(ranks.size() != model.m_weights.size()) {
+            throw std::length_error("need one rank per layer");
+        }
+        for(int i=0; i<ranks.size(); ++i) {
+            const auto& weight = model.m_weights[i];
+            if(ranks[i] == 0) {
+                m_layers.push_back({ 0, weight, Matrix<double>() });
+                continue;
+            }
+            auto svd = randomizedSvd(weight, ranks[i]);
+            for(int r=0; r<ranks[i]; ++r) {
+                for(int j=0; j<weight.getRows(); ++j) {
+                    svd.u[j][r] *= svd.s[r];
+                }
+            }
+            m_layers.push_back({ ranks[i], svd.u, svd.vt });
+        }
+    }
+
+    DnnModel toDense() const {
+        DnnModel model{m_learningRate, {}};
+        for(const auto& layer: m_layers) {
+            model.m_weights.push_back(layer.toDense());
+        }
+        return model;
+    }
+
+    long getFlops() const {
+        long flops = 0;
+        for(const auto& layer: m_layers) {
+            flops += layer.getFlops();
+        }
+        return flops;
+    }
+
+    void saveModel(const std::string& fileName) const {
+        auto index = fileName.find_last_of('.');
+        auto extension = fileName.substr(index+1);
+        if(extension == "rlm") {
+            saveRawModel(fileName);
+        } else {
+            throw std::invalid_argument(extension + ": no file format for extension");
+        }
+    }
+
+    static auto loadModel(const std::string& fileName) {
+        auto index = fileName.find_last_of('.');
+        auto extension = fileName.substr(index+1);
+        if(extension == "rlm") {
+            return loadRawModel(fileName);
+        } else {
+            throw std::invalid_argument(extension + ": no file format for extension");
+        }
+    }
+
+private:
+    static void writeMatrix(std::ostream& file, const Matrix<double>& mat) {
+        file.write((char*)&mat.getRows(), sizeof(mat.getRows()));
+        file.write((char*)&mat.getCols(), sizeof(mat.getCols()));
+        file.write((char*)mat.data(), sizeof(double) * mat.getRows() * mat.getCols());
+    }
+
+    static Matrix<double> readMatrix(std::istream& file) {
+        int rows, cols;
+        file.read((char*)&rows, sizeof(rows));
+        file.read((char*)&cols, sizeof(cols));
+        Matrix<double> mat(rows, cols);
+        file.read((char*)mat.data(), sizeof(double) * rows * cols);
+        return mat;
+    }
+
+    void saveRawModel(const std::string& fileName) const {
+        std::ofstream file(fileName, std::ios::binary);
+        file.exceptions(std::ios::failbit | std::ios::badbit);
+
+        file.write((char*)&m_learningRate, sizeof(m_learningRate));
+        int size = m_layers.size();
+        file.write((char*)&size, sizeof(size));
+
+        for(const auto& layer: m_layers) {
+            file.write((char*)&layer.rank, sizeof(layer.rank));
+            writeMatrix(file, layer.left);
+            if(layer.rank) {
+                writeMatrix(file, layer.right);
+            }
+        }
+    }
+
+    static LowRankDnnModel loadRawModel(const std::string& fileName) {
+        std::ifstream file(fileName, std::ios::binary);
+        file.exceptions(std::ios::failbit | std::ios::badbit);
+
+        LowRankDnnModel model;
+        file.read((char*)&model.m_learningRate, sizeof(model.m_learningRate));
+        int layerCount;
+        file.read((char*)&layerCount, sizeof(layerCount));
+        for(int i=0; i<layerCount; ++i) {
+            LowRankLayer layer;
+            file.read((char*)&layer.rank, sizeof(layer.rank));
+            layer.left = readMatrix(file);
+            if(layer.rank) {
+                layer.right = readMatrix(file);
+            }
+            model.m_layers.push_back(layer);
+        }
+        return model;
+    }
+public:
+    double m_learningRate;
+    std::vector<LowRankLayer> m_layers;
+};
+
+#endif
@@ -1,8 +1,35 @@
 #include "matrix.hpp"
 #include "mnist.hpp"
 #include "dnn.hpp"
+#include "sparseDnn.hpp"
+#include "lowRankDnn.hpp"
+#include "pruner.hpp"
+#include "checkpoint.hpp"
+#include "image.hpp"
+#include "shardedDataset.hpp"
+#include "csvDataset.hpp"
+#include "cnn.hpp"
+#include "executor.hpp"
+#include "distributed.hpp"
+#include "compiler.hpp"
+#include "inferenceSession.hpp"
+#include "ensemble.hpp"
+#include "onlineLearner.hpp"
+#include "gemmAutotuner.hpp"
+#include "halfDnn.hpp"
+#include "augmentation.hpp"
+#include "pipelineTrainer.hpp"
+#include "recomputingTrainer.hpp"
+#include "cascade.hpp"
+#include "featureCache.hpp"
+#include <chrono>
+#include <iomanip>
+#include <fstream>
+#include <numeric>
+#include <sys/resource.h>
 
-void train(DNN& neural, const std::string& fileName, const int& count, const int& epoch) {
+template<typename Net>
+void train(Net& neural, const std::string& fileName, const int& count, const int& epoch, const bool& verbose = true) {
     Mnist mnist(fileName);
 
     std::vector<double> target(10);
@@ -15,10 +42,198 @@ void train(DNN& neural, const std::string& fileName, const int& count, const int
             neural.train(data.pixels, target);
             target[data.label] = 0.01;
         }
-        system("clear");
-        std::cout << "Epoch " << i << " of " << epoch << '\n';
-        std::cout << "Error: " << neural.getError() << std::flush;
+        if (verbose) {
+            system("clear");
+            std::cout << "Epoch " << i << " of " << epoch << '\n';
+            std::cout << "Error: " << neural.getError() << std::flush;
+        }
+    }
+}
+
+void train_checkpointed(const std::string& fileName, const int& count, const int& epoch, const std::string& checkpointFile, const int& interval)
+{
+    DnnModel model;
+    TrainingState state{ 1, 0, 0 };
+    const auto resumed = Checkpointer::resume(checkpointFile, model, state);
+    DNN neural = resumed ? DNN(model) : DNN({ 784,100,10 }, 0.1);
+    if (resumed) {
+        std::cout << "Resuming epoch " << state.epoch << " at sample " << state.sample << '\n';
+    }
+
+    Mnist mnist(fileName);
+    Checkpointer checkpointer(checkpointFile);
+    std::vector<double> target(10, 0.01);
+
+    for (int i = state.epoch; i <= epoch; ++i) {
+        int j = 0;
+        if (i == state.epoch && state.sample > 0) {
+            mnist.seek(state.offset);
+            j = state.sample;
+        } else {
+            mnist.reset();
+        }
+        for (++j; j <= count; ++j) {
+            auto data = mnist.getNextData();
+            target[data.label] = 0.99;
+            neural.train(data.pixels, target);
+            target[data.label] = 0.01;
+
+            if (j % interval == 0) {
+                checkpointer.save(neural, { i, j, mnist.tell() });
+            }
+        }
+        std::cout << "Epoch " << i << " of " << epoch << " Error: " << neural.getError() << '\n';
+    }
+
+    checkpointer.save(neural, { epoch + 1, 0, 0 });
+    checkpointer.wait();
+    neural.saveModel("checkpointed_mnist_" + std::to_string(count) + ".rwm");
+}
+
+void train_stream(const std::string& directory, const int& epoch, const int& window)
+{
+    DNN neural({ 784,100,10 }, 0.1);
+    auto dataset = ShardedDataset::fromDirectory(directory, window);
+
+    MnistData data;
+    std::vector<double> target(10, 0.01);
+
+    for (int i = 1; i <= epoch; ++i) {
+        dataset.reset();
+        auto start = std::chrono::steady_clock::now();
+        long count = 0;
+        while (dataset.getNextData(data)) {
+            target[data.label] = 0.99;
+            neural.train(data.pixels, target);
+            target[data.label] = 0.01;
+            ++count;
+        }
+        std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+        std::cout << "Epoch " << i << " of " << epoch << ": " << count << " samples, "
+                  << dataset.getBytesRead() / elapsed.count() / (1 << 20) << " MiB/s, Error: " << neural.getError() << '\n';
     }
+
+    neural.saveModel("stream_mnist.rwm");
+}
+
+void train_executor(const std::string& fileName, const int& count, const int& epoch, const int& batch)
+{
+    DNN initial({ 784,100,10 }, 0.1);
+    Executor executor(initial.getModel(), batch);
+    executor.getPlan().print(std::cout);
+
+    CsvDataset csv(fileName);
+    if (csv.getRows() < count) {
+        throw std::length_error(fileName + ": fewer than " + std::to_string(count) + " samples");
+    }
+    std::vector<double> targets(10 * count, 0.01);
+    for (int j = 0; j < count; ++j) {
+        targets[j * 10 + csv.getLabels()[j]] = 0.99;
+    }
+
+    const auto dataset = csv.getSamples();
+    const ConstMatrixView<double> labels(targets.data(), count, 10, 10);
+
+    for (int i = 1; i <= epoch; ++i) {
+        for (int j = 0; j + batch <= count; j += batch) {
+            executor.train(dataset.block(j, 0, batch, 784).transpose(), labels.block(j, 0, batch, 10).transpose());
+        }
+        std::cout << "Epoch " << i << " of " << epoch << " Error: " << executor.getError() << '\n';
+    }
+
+    Executor inference(executor.getModel(), 1, false);
+    inference.getPlan().print(std::cout);
+    executor.getModel().saveModel("executor_mnist_" + std::to_string(count) + ".rwm");
+}
+
+// Number of weights, summed over all ranks, that differ from rank 0's.
+// Rank 0's weights reach everyone exactly through an all-reduce where the
+// other ranks contribute zeros, and every rank compares element by element.
+long weightMismatches(RingCommunicator& ring, const int& rank, const DnnModel& model)
+{
+    double mismatches = 0;
+    for (const auto& weight : model.m_weights) {
+        const int size = weight.getRows() * weight.getCols();
+        std::vector<double> reference(weight.data(), weight.data() + size);
+        if (rank != 0) {
+            std::fill(reference.begin(), reference.end(), 0.0);
+        }
+        ring.allReduce(reference.data(), size);
+        for (int i = 0; i < size; ++i) {
+            mismatches += reference[i] != weight.data()[i];
+        }
+    }
+    ring.allReduce(&mismatches, 1);
+    return long(mismatches);
+}
+
+int distributed_worker(const std::string& fileName, const int& count, const int& epoch, const int& batch,
+                       const int& rank, const int& size, const std::string& nextHost, const int& port)
+{
+    RingCommunicator ring(rank, size, nextHost, port);
+
+    auto model = DNN({ 784,100,10 }, 0.1).getModel();
+    for (auto& weight : model.m_weights) {
+        if (rank != 0) {
+            std::fill(weight.data(), weight.data() + weight.getRows() * weight.getCols(), 0.0);
+        }
+        ring.allReduce(weight.data(), weight.getRows() * weight.getCols());
+    }
+    DNN neural(model);
+
+    GradientReducer reducer(ring, neural.getGradients());
+    Mnist mnist(fileName);
+    std::vector<double> target(10, 0.01);
+    const int steps = count / size / batch;
+
+    for (int i = 1; i <= epoch; ++i) {
+        mnist.reset();
+        int j = 0;
+        for (int step = 0; step < steps; ++step) {
+            for (int b = 0; b < batch; ++j) {
+                auto data = mnist.getNextData();
+                if (j % size != rank) {
+                    continue;
+                }
+                target[data.label] = 0.99;
+                if (++b < batch) {
+                    neural.accumulate(data.pixels, target);
+                } else {
+                    neural.accumulate(data.pixels, target, [&](const int& layer) { reducer.ready(layer); });
+                }
+                target[data.label] = 0.01;
+            }
+            reducer.wait();
+            neural.applyGradients(1.0 / size);
+        }
+        if (rank == 0) {
+            std::cout << "Epoch " << i << " of " << epoch << " Error: " << neural.getError() << std::endl;
+        }
+    }
+
+    const long mismatches = weightMismatches(ring, rank, neural.getModel());
+    if (mismatches != 0) {
+        std::cerr << "rank " << rank << ": " << mismatches << " weights differ between ranks\n";
+        return 1;
+    }
+
+    if (rank == 0) {
+        std::cout << "Weights identical on all " << size << " ranks (" << reducer.getBucketCount() << " gradient buckets)\n";
+        neural.saveModel("distributed_mnist_" + std::to_string(count) + ".rwm");
+    }
+    return 0;
+}
+
+int argmax(const Matrix<double>& pred) {
+    double max = 0;
+    auto prediction = 0;
+    for (int i = 0; i < pred.getRows(); ++i) {
+        if (max < pred[i][0]) {
+            max = pred[i][0];
+            prediction = i;
+        }
+    }
+    return prediction;
 }
 
 auto test(DNN& neural, const std::string& fileName, const int& count) {
@@ -30,15 +245,7 @@ auto test(DNN& neural, const std::string& fileName, const int& count) {
     for (int j = 1; j <= count; ++j) {
         auto data = mnist.getNextData();
         auto pred = neural.query(data.pixels);
-        double max = 0;
-        auto prediction = 0;
-        for (int i = 0; i < pred.getRows(); ++i) {
-            if (max < pred[i][0]) {
-                max = pred[i][0];
-                prediction = i;
-            }
-        }
-        if (prediction == data.label) {
+        if (argmax(pred) == data.label) {
             ++success;
         }
         system("clear");
@@ -48,18 +255,289 @@ auto test(DNN& neural, const std::string& fileName, const int& count) {
     return 100 * (success / double(count));
 }
 
+struct Evaluation {
+    double accuracy;
+    double microseconds;
+};
+
+template<typename Net>
+Evaluation evaluate(Net& neural, const std::string& fileName, const int& count) {
+
+    Mnist mnist(fileName);
+    auto samples = mnist.getNextBatch(count);
+
+    std::vector<Vertex<double>> inputs;
+    for (const auto& sample : samples) {
+        inputs.emplace_back(sample.pixels);
+    }
+
+    auto success = 0;
+    auto start = std::chrono::steady_clock::now();
+    for (int j = 0; j < count; ++j) {
+        if (argmax(neural.query(inputs[j])) == samples[j].label) {
+            ++success;
+        }
+    }
+    std::chrono::duration<double, std::micro> elapsed = std::chrono::steady_clock::now() - start;
+
+    return { 100 * (success / double(count)), elapsed.count() / count };
+}
+
+// Same over samples already in memory, (features x count), one per column.
+template<typename Net>
+Evaluation evaluate(Net& neural, const ConstMatrixView<double>& samples, const std::vector<int>& labels) {
+
+    auto success = 0;
+    auto start = std::chrono::steady_clock::now();
+    for (int j = 0; j < samples.getCols(); ++j) {
+        if (argmax(neural.query(samples.column(j))) == labels[j]) {
+            ++success;
+        }
+    }
+    std::chrono::duration<double, std::micro> elapsed = std::chrono::steady_clock::now() - start;
+
+    return { 100 * (success / double(samples.getCols())), elapsed.count() / samples.getCols() };
+}
+
+auto fileSize(const std::string& fileName) {
+    std::ifstream file(fileName, std::ios::binary | std::ios::ate);
+    return long(file.tellg());
+}
+
+void csv_bench(const std::string& fileName)
+{
+    auto start = std::chrono::steady_clock::now();
+    Mnist mnist(fileName);
+    int rows = 0;
+    try {
+        for (;;) {
+            mnist.getNextData();
+            ++rows;
+        }
+    } catch (const std::ios::failure&) {
+    }
+    std::chrono::duration<double> lines = std::chrono::steady_clock::now() - start;
+
+    start = std::chrono::steady_clock::now();
+    CsvDataset csv(fileName);
+    std::chrono::duration<double> bulk = std::chrono::steady_clock::now() - start;
+
+    const double megabytes = fileSize(fileName) / 1e6;
+    std::cout << std::fixed << std::setprecision(2);
+    std::cout << "Mnist::getNextData: " << rows << " rows " << lines.count() << "s " << megabytes / lines.count() << " MB/s\n";
+    std::cout << "CsvDataset:         " << csv.getRows() << " rows " << bulk.count() << "s " << megabytes / bulk.count() << " MB/s (x"
+              << lines.count() / bulk.count() << ")\n";
+}
+
+void prune_test(const std::string& modelFile, const std::string& trainFile, const std::string& testFile, const int& count, const int& epoch)
+{
+    const auto baseline = DnnModel::loadModel(modelFile);
+    DNN dense(baseline);
+    const auto reference = evaluate(dense, testFile, count);
+
+    std::cout << std::fixed << std::setprecision(2);
+    std::cout << "dense: " << reference.accuracy << "% " << reference.microseconds << "us/query "
+              << fileSize(modelFile) << " bytes\n";
+
+    for (auto sparsity : { 0.5, 0.7, 0.8, 0.9, 0.95 }) {
+        auto model = baseline;
+        auto pruner = Pruner::sparsity(sparsity);
+        pruner.prune(model);
+
+        for (int i = 0; i < epoch; ++i) {
+            DNN neural(model);
+            train(neural, trainFile, count, 1);
+            model = neural.getModel();
+            pruner.reapply(model);
+        }
+
+        SparseDnnModel sparseModel(model);
+        auto sparseFile = std::to_string(int(sparsity * 100)) + "_pruned.rsm";
+        sparseModel.saveModel(sparseFile);
+
+        SparseDNN sparse(SparseDnnModel::loadModel(sparseFile));
+        const auto result = evaluate(sparse, testFile, count);
+
+        std::cout << "sparsity " << 100 * Pruner::getSparsity(model) << "%: "
+                  << result.accuracy << "% (" << result.accuracy - reference.accuracy << ") "
+                  << result.microseconds << "us/query (x" << reference.microseconds / result.microseconds << ") "
+                  << fileSize(sparseFile) << " bytes\n";
+    }
+}
+
+void lowrank_test(const std::string& modelFile, const std::string& testFile, const int& count, const double& budget)
+{
+    // Ranks are chosen on the first count rows and everything is reported
+    // on the rest, so the budget is not met by construction.
+    const CsvDataset test(testFile);
+    if (count <= 0 || count >= test.getRows()) {
+        throw std::invalid_argument("calibration count must leave samples to evaluate on");
+    }
+    const auto samples = test.getSamples().transpose();
+    const auto calibration = samples.block(0, 0, samples.getRows(), count);
+    const auto evaluation = samples.block(0, count, samples.getRows(), samples.getCols() - count);
+    const std::vector<int> calibrationLabels(test.getLabels().begin(), test.getLabels().begin() + count);
+    const std::vector<int> labels(test.getLabels().begin() + count, test.getLabels().end());
+
+    const auto baseline = DnnModel::loadModel(modelFile);
+    DNN dense(baseline);
+    const double calibrated = evaluate(dense, calibration, calibrationLabels).accuracy;
+
+    std::vector<int> ranks(baseline.m_weights.size(), 0);
+    auto accuracy = [&](const std::vector<int>& candidate) {
+        LowRankDNN neural(LowRankDnnModel(baseline, candidate));
+        return evaluate(neural, calibration, calibrationLabels).accuracy;
+    };
+
+    // Largest layers first. A rank only saves work below rows*cols/(rows+cols),
+    // and within that range accuracy is assumed to grow with the rank, so the
+    // smallest rank that stays within the budget is found by bisection.
+    std::vector<int> order(ranks.size());
+    std::iota(order.begin(), order.end(), 0);
+    std::sort(order.begin(), order.end(), [&](const int& a, const int& b) {
+        return baseline.m_weights[a].getRows() * baseline.m_weights[a].getCols() >
+               baseline.m_weights[b].getRows() * baseline.m_weights[b].getCols();
+    });
+
+    for (auto layer : order) {
+        const auto& weight = baseline.m_weights[layer];
+        int low = 1, high = weight.getRows() * weight.getCols() / (weight.getRows() + weight.getCols()) - 1;
+        high = std::min(high, std::min(weight.getRows(), weight.getCols()));
+        int best = 0;
+        while (low <= high) {
+            auto candidate = ranks;
+            candidate[layer] = (low + high) / 2;
+            if (calibrated - accuracy(candidate) <= budget) {
+                best = candidate[layer];
+                high = candidate[layer] - 1;
+            } else {
+                low = candidate[layer] + 1;
+            }
+        }
+        ranks[layer] = best;
+    }
+
+    LowRankDnnModel model(baseline, ranks);
+    model.saveModel("lowrank.rlm");
+    LowRankDNN factorized(LowRankDnnModel::loadModel("lowrank.rlm"));
+    const auto reference = evaluate(dense, evaluation, labels);
+    const auto result = evaluate(factorized, evaluation, labels);
+    const long denseFlops = LowRankDnnModel(baseline, std::vector<int>(ranks.size(), 0)).getFlops();
+
+    std::cout << std::fixed << std::setprecision(2);
+    for (int i = 0; i < ranks.size(); ++i) {
+        std::cout << "layer " << i << " " << baseline.m_weights[i].getRows() << "x" << baseline.m_weights[i].getCols() << ": "
+                  << (ranks[i] ? "rank " + std::to_string(ranks[i]) : std::string("dense")) << '\n';
+    }
+    std::cout << "ranks chosen on " << count << " samples, measured on the other " << evaluation.getCols() << '\n';
+    std::cout << "dense:    " << reference.accuracy << "% " << reference.microseconds << "us/query "
+              << denseFlops << " flops " << fileSize(modelFile) << " bytes\n";
+    std::cout << "low rank: " << result.accuracy << "% (" << result.accuracy - reference.accuracy << ") "
+              << result.microseconds << "us/query (x" << reference.microseconds / result.microseconds << ") "
+              << model.getFlops() << " flops (x" << double(denseFlops) / model.getFlops() << ") "
+              << fileSize("lowrank.rlm") << " bytes\n";
+}
+
+void ensemble_test(const std::string& testFile, const int& count, const std::string& combine, const std::vector<std::string>& modelFiles)
+{
+    std::vector<DnnModel> models;
+    double separate = 0;
+    std::cout << std::fixed << std::setprecision(2);
+    for (const auto& modelFile : modelFiles) {
+        models.push_back(DnnModel::loadModel(modelFile));
+        DNN neural(models.back());
+        const auto result = evaluate(neural, testFile, count);
+        separate += result.microseconds;
+        std::cout << modelFile << ": " << result.accuracy << "% " << result.microseconds << "us/query\n";
+    }
+
+    if (combine != "mean" && combine != "vote") {
+        throw std::invalid_argument(combine + ": combine must be mean or vote");
+    }
+    Ensemble ensemble(models, combine == "vote" ? Ensemble::Combine::vote : Ensemble::Combine::mean);
+    const auto result = evaluate(ensemble, testFile, count);
+    std::cout << "ensemble of " << ensemble.getSize() << " (" << combine << "): " << result.accuracy << "% "
+              << result.microseconds << "us/query, " << separate << "us/query as separate models (x"
+              << separate / result.microseconds << ")\n";
+}
+
+void train_online(const std::string& modelFile, const std::string& trainFile, const std::string& testFile, const int& count, const int& readers)
+{
+    const auto model = DnnModel::loadModel(modelFile);
+    const CsvDataset train(trainFile), test(testFile);
+    OnlineLearner learner(model, 500);
+
+    std::atomic<bool> done{ false };
+    std::vector<long> queries(readers, 0);
+    std::vector<int> stale(readers, 0);
+    std::vector<std::thread> threads;
+    auto start = std::chrono::steady_clock::now();
+    for (int r = 0; r < readers; ++r) {
+        threads.emplace_back([&, r] {
+            OnlineLearner::Reader reader(learner);
+            long previous = 0;
+            for (int j = r % test.getRows(); !done.load(); j = (j + readers) % test.getRows()) {
+                reader.query(test.getSample(j));
+                stale[r] += reader.getVersion() < previous;
+                previous = reader.getVersion();
+                ++queries[r];
+            }
+        });
+    }
+
+    const auto samples = train.getSamples();
+    for (int j = 0; j < count; ++j) {
+        std::vector<double> target(10, 0.01);
+        target[train.getLabels()[j % train.getRows()]] = 0.99;
+        const double* row = &samples(j % train.getRows(), 0);
+        learner.submit(std::vector<double>(row, row + train.getFeatures()), std::move(target));
+    }
+    learner.stop();
+    done = true;
+    for (auto& thread : threads) {
+        thread.join();
+    }
+    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+
+    DNN before(model), after(learner.getModel());
+    const long total = std::accumulate(queries.begin(), queries.end(), 0L);
+    std::cout << std::fixed << std::setprecision(2);
+    std::cout << "trained " << learner.getTrained() << " samples, published " << learner.getVersion() << " snapshots\n";
+    std::cout << readers << " readers: " << total / elapsed.count() << " queries/s, "
+              << std::accumulate(stale.begin(), stale.end(), 0) << " went back a version\n";
+    std::cout << "accuracy " << evaluate(before, testFile, test.getRows()).accuracy << "% -> "
+              << evaluate(after, testFile, test.getRows()).accuracy << "%\n";
+}
+
 void learn(const double& percentage, const int& count, const int& epoch)
 {
     srand(time(0));
 
+    const int candidates = Scheduler::instance().getConcurrency();
+
     for (;;) {
-        DNN neural({ 784,100,10 }, 0.1);
+        std::vector<std::unique_ptr<DNN>> networks;
+        std::vector<double> success(candidates);
+        std::vector<int> epochs(candidates);
+        for (int c = 0; c < candidates; ++c) {
+            networks.push_back(std::make_unique<DNN>(std::vector<int>{ 784,100,10 }, 0.1));
+            epochs[c] = rand() % epoch + 1;
+        }
+
+        TaskGroup group;
+        for (int c = 0; c < candidates; ++c) {
+            group.run([&, c] {
+                train(*networks[c], "/usr/share/mnist/mnist_train.csv", count, epochs[c], false);
+                success[c] = evaluate(*networks[c], "/usr/share/mnist/mnist_test.csv", count).accuracy;
+            });
+        }
+        group.wait();
 
-        train(neural, "/usr/share/mnist/mnist_train.csv", count, rand() % epoch + 1);
-        auto success = test(neural, "/usr/share/mnist/mnist_test.csv", count);
+        auto best = std::max_element(success.begin(), success.end()) - success.begin();
+        std::cout << "Best of " << candidates << ": " << success[best] << "%\n";
 
-        if (success > percentage) {
-            neural.saveModel(std::to_string(int(success)) + "_mnist_" + std::to_string(count) + ".rwm");
+        if (success[best] > percentage) {
+            networks[best]->saveModel(std::to_string(int(success[best])) + "_mnist_" + std::to_string(count) + ".rwm");
             break;
         }
     }
@@ -84,8 +562,606 @@ void reverse_test(DNN& neural, const int& number)
     mnist.draw();
 }
 
+void reverse_sheet(DNN& neural, const std::string& prefix)
+{
+    Matrix<double> targets(10, 10);
+    for (int i = 0; i < 10; ++i) {
+        for (int j = 0; j < 10; ++j) {
+            targets[i][j] = (i == j) ? 0.99 : 0.01;
+        }
+    }
+
+    auto images = neural.reverse_query(targets);
+    saveImageSheet(prefix + "_sheet.pgm", images, 28, 5);
+
+    for (int n = 0; n < images.getCols(); ++n) {
+        Vertex<double> image(images.getRows());
+        for (int i = 0; i < images.getRows(); ++i) {
+            image[i][0] = images[i][n];
+        }
+        saveImageSheet(prefix + "_" + std::to_string(n) + ".pgm", image, 28, 1);
+    }
+}
+
+auto mnistConvNet()
+{
+    return std::vector<LayerSpec>{
+        LayerSpec::conv2D(1, 28, 28, 8, 5),
+        LayerSpec::maxPool2D(8, 24, 24, 2),
+        LayerSpec::dense(8 * 12 * 12, 10)
+    };
+}
+
+void learn_cnn(const std::string& trainFile, const std::string& testFile, const int& count, const int& epoch)
+{
+    CNN neural(mnistConvNet(), 0.1);
+    train(neural, trainFile, count, epoch);
+    auto result = evaluate(neural, testFile, count);
+    std::cout << "\nSuccess: " << result.accuracy << "% " << result.microseconds << "us/query\n";
+    neural.saveModel(std::to_string(int(result.accuracy)) + "_mnist_" + std::to_string(count) + ".rcm");
+}
+
+void conv_bench(const int& iterations)
+{
+    const auto spec = LayerSpec::conv2D(1, 28, 28, 8, 5);
+    Conv2D conv(spec);
+    Vertex<double> image(28 * 28);
+    for (int i = 0; i < image.getRows(); ++i) {
+        image[i][0] = (i % 255) / 255.0;
+    }
+    Vertex<double> error(8 * 24 * 24);
+
+    const double flops = 2.0 * spec.outputs * (spec.channels * spec.kernel * spec.kernel) * (conv.getOutHeight() * conv.getOutWidth());
+
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < iterations; ++i) {
+        conv.forward(image);
+    }
+    std::chrono::duration<double> forward = std::chrono::steady_clock::now() - start;
+
+    start = std::chrono::steady_clock::now();
+    for (int i = 0; i < iterations; ++i) {
+        conv.forward(image);
+        conv.backward(image, error, 0.1);
+    }
+    std::chrono::duration<double> training = std::chrono::steady_clock::now() - start;
+
+    std::cout << "conv 1x28x28 -> 8x24x24 (5x5)\n";
+    std::cout << "forward:  " << iterations / forward.count() << " images/s, "
+              << flops * iterations / forward.count() * 1e-9 << " GFLOP/s\n";
+    std::cout << "training: " << iterations / training.count() << " images/s, "
+              << 3 * flops * iterations / training.count() * 1e-9 << " GFLOP/s\n";
+}
+
+void serve_bench(const std::string& modelFile, const std::string& fileName, const int& count, const int& maxThreads)
+{
+    const InferenceSession session(DnnModel::loadModel(modelFile));
+
+    Mnist mnist(fileName);
+    const auto samples = mnist.getNextBatch(count);
+
+    std::cout << "weights: " << session.getWeightBytes() << " bytes shared by every thread\n";
+    std::cout << std::fixed << std::setprecision(2);
+
+    double single = 0;
+    for (int threads = 1; threads <= maxThreads; threads *= 2) {
+        std::vector<int> success(threads);
+        std::vector<std::thread> workers;
+
+        auto start = std::chrono::steady_clock::now();
+        for (int t = 0; t < threads; ++t) {
+            workers.emplace_back([&, t] {
+                InferenceSession::Context context;
+                for (int j = t; j < count; j += threads) {
+                    auto output = session.query(context, samples[j].pixels);
+                    int prediction = 0;
+                    for (int i = 1; i < output.getRows(); ++i) {
+                        if (output(i, 0) > output(prediction, 0)) {
+                            prediction = i;
+                        }
+                    }
+                    success[t] += prediction == samples[j].label;
+                }
+            });
+        }
+        for (auto& worker : workers) {
+            worker.join();
+        }
+        std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+
+        const double throughput = count / elapsed.count();
+        if (threads == 1) {
+            single = throughput;
+        }
+        const int correct = std::accumulate(success.begin(), success.end(), 0);
+        std::cout << threads << " threads: " << throughput << " queries/s (x" << throughput / single << ") "
+                  << 100.0 * correct / count << "%\n";
+    }
+}
+
+template<typename H>
+void half_report(const DnnModel& baseline, const std::string& modelFile, const std::string& testFile, const int& count, const double& reference,
+                 const std::string& trainFile, const int& epoch, const double& tunedReference)
+{
+    const auto fileName = modelFile.substr(0, modelFile.find_last_of('.') + 1) + H::extension;
+    HalfDnnModel<H>(baseline).saveModel(fileName);
+    HalfDNN<H> neural(HalfDnnModel<H>::loadModel(fileName));
+
+    const auto result = evaluate(neural, testFile, count);
+    std::cout << H::name << ": " << result.accuracy << "% (" << result.accuracy - reference << "), "
+              << result.microseconds << "us/query, " << neural.getWeightBytes() << " weight bytes, saved to " << fileName << '\n';
+
+    // Fine-tunes the 16 bit model itself, through its float masters.
+    if (epoch > 0) {
+        train(neural, trainFile, count, epoch, false);
+        const auto tuned = evaluate(neural, testFile, count);
+        std::cout << H::name << " fine-tuned " << epoch << " epochs: " << tuned.accuracy << "% ("
+                  << tuned.accuracy - tunedReference << " vs double)\n";
+    }
+}
+
+void half_test(const std::string& modelFile, const std::string& testFile, const int& count, const std::string& trainFile = "", const int& epoch = 0)
+{
+    const auto baseline = DnnModel::loadModel(modelFile);
+    DNN dense(baseline);
+    const auto reference = evaluate(dense, testFile, count);
+
+    long bytes = 0;
+    for (const auto& weight : baseline.m_weights) {
+        bytes += sizeof(double) * weight.getRows() * weight.getCols();
+    }
+    std::cout << std::fixed << std::setprecision(2);
+    std::cout << "double: " << reference.accuracy << "%, " << reference.microseconds << "us/query, " << bytes << " weight bytes\n";
+
+    double tunedReference = 0;
+    if (epoch > 0) {
+        train(dense, trainFile, count, epoch, false);
+        tunedReference = evaluate(dense, testFile, count).accuracy;
+        std::cout << "double fine-tuned " << epoch << " epochs: " << tunedReference << "%\n";
+    }
+    half_report<bfloat16>(baseline, modelFile, testFile, count, reference.accuracy, trainFile, epoch, tunedReference);
+    half_report<float16>(baseline, modelFile, testFile, count, reference.accuracy, trainFile, epoch, tunedReference);
+}
+
+void train_augmented(const std::string& trainFile, const std::string& testFile, const int& count, const int& epoch, const int& workers)
+{
+    CsvDataset csv(trainFile);
+    if (csv.getRows() < count) {
+        throw std::length_error(trainFile + ": fewer than " + std::to_string(count) + " samples");
+    }
+    const auto samples = csv.getSamples().block(0, 0, count, csv.getFeatures());
+    std::cout << std::fixed << std::setprecision(2);
+
+    {
+        AugmentationPipeline pipeline(samples, csv.getLabels(), Augmentation(), workers);
+        MnistData data;
+        auto start = std::chrono::steady_clock::now();
+        for (int j = 0; j < count; ++j) {
+            pipeline.next(data);
+        }
+        std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+        std::cout << "augmentation alone: " << count / elapsed.count() << " samples/s with " << workers << " workers\n";
+    }
+
+    std::vector<double> target(10, 0.01);
+    auto run = [&](const bool& augment) {
+        DNN neural({ 784,100,10 }, 0.1);
+        std::unique_ptr<AugmentationPipeline> pipeline;
+        if (augment) {
+            pipeline = std::make_unique<AugmentationPipeline>(samples, csv.getLabels(), Augmentation(), workers);
+        }
+
+        MnistData data;
+        auto start = std::chrono::steady_clock::now();
+        for (int i = 0; i < epoch; ++i) {
+            for (int j = 0; j < count; ++j) {
+                if (augment) {
+                    pipeline->next(data);
+                    target[data.label] = 0.99;
+                    neural.train(data.pixels, target);
+                    target[data.label] = 0.01;
+                } else {
+                    target[csv.getLabels()[j]] = 0.99;
+                    neural.train(csv.getSample(j), target);
+                    target[csv.getLabels()[j]] = 0.01;
+                }
+            }
+        }
+        std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+
+        std::cout << (augment ? "augmented: " : "plain:     ") << long(epoch) * count / elapsed.count() << " samples/s, test "
+                  << evaluate(neural, testFile, 1000).accuracy << "%";
+        if (augment) {
+            std::cout << ", waited " << pipeline->getStallSeconds() << "s of " << elapsed.count() << "s for samples";
+        }
+        std::cout << '\n';
+    };
+    run(false);
+    run(true);
+}
+
+void train_pipeline(const std::string& fileName, const int& count, const int& epoch, const int& stages, const int& microBatch, const int& batch, const std::vector<int>& topology)
+{
+    DNN initial(topology, 0.1);
+    PipelineTrainer pipeline(initial.getModel(), stages, microBatch);
+    Executor executor(initial.getModel(), batch);
+    pipeline.print(std::cout);
+
+    CsvDataset csv(fileName, topology.front());
+    if (csv.getRows() < count) {
+        throw std::length_error(fileName + ": fewer than " + std::to_string(count) + " samples");
+    }
+    const int outputs = topology.back();
+    std::vector<double> targets(outputs * count, 0.01);
+    for (int j = 0; j < count; ++j) {
+        targets[j * outputs + csv.getLabels()[j] % outputs] = 0.99;
+    }
+    const auto dataset = csv.getSamples();
+    const ConstMatrixView<double> labels(targets.data(), count, outputs, outputs);
+
+    auto run = [&](auto& trainer, const std::string& name) {
+        auto start = std::chrono::steady_clock::now();
+        for (int i = 1; i <= epoch; ++i) {
+            for (int j = 0; j + batch <= count; j += batch) {
+                trainer.train(dataset.block(j, 0, batch, topology.front()).transpose(), labels.block(j, 0, batch, outputs).transpose());
+            }
+        }
+        std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+        std::cout << name << ": " << long(epoch) * (count / batch) * batch / elapsed.count() << " samples/s, Error: " << trainer.getError() << '\n';
+    };
+    run(executor, "executor");
+    run(pipeline, std::to_string(stages) + " stage pipeline");
+}
+
+void train_recomputing(const std::string& fileName, const int& count, const int& epoch, const int& microBatch, const int& batch, const std::size_t& budget, const std::vector<int>& topology)
+{
+    DNN initial(topology, 0.1);
+    RecomputingTrainer trainer(initial.getModel(), microBatch, budget);
+
+    std::cout << "checkpoints:";
+    for (auto layer : trainer.getCheckpoints()) {
+        std::cout << ' ' << layer;
+    }
+    std::cout << "\nactivations: " << trainer.getPeakBytes() << " bytes per micro-batch of " << microBatch
+              << " (" << trainer.getKeepAllBytes() << " keeping every output), recompute "
+              << 100 * trainer.getRecomputeRatio() << "% of a forward pass\n";
+    std::cout << "gradients: " << trainer.getGradientBytes() << " bytes, effective batch " << batch << '\n';
+
+    CsvDataset csv(fileName, topology.front());
+    if (csv.getRows() < count) {
+        throw std::length_error(fileName + ": fewer than " + std::to_string(count) + " samples");
+    }
+    const int outputs = topology.back();
+    std::vector<double> targets(outputs * count, 0.01);
+    for (int j = 0; j < count; ++j) {
+        targets[j * outputs + csv.getLabels()[j] % outputs] = 0.99;
+    }
+    const auto dataset = csv.getSamples();
+    const ConstMatrixView<double> labels(targets.data(), count, outputs, outputs);
+
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 1; i <= epoch; ++i) {
+        for (int j = 0; j + batch <= count; j += batch) {
+            trainer.train(dataset.block(j, 0, batch, topology.front()).transpose(), labels.block(j, 0, batch, outputs).transpose());
+        }
+        std::cout << "Epoch " << i << " of " << epoch << " Error: " << trainer.getError() << '\n';
+    }
+    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+
+    struct rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+    std::cout << long(epoch) * (count / batch) * batch / elapsed.count() << " samples/s, peak resident "
+              << usage.ru_maxrss << " KiB\n";
+}
+
+void cascade_test(const std::string& testFile, const int& count, const double& target, const std::vector<std::string>& modelFiles)
+{
+    const CsvDataset test(testFile);
+    if (count <= 0 || count >= test.getRows()) {
+        throw std::invalid_argument("calibration count must leave samples to evaluate on");
+    }
+    const auto samples = test.getSamples().transpose();
+    const auto calibration = samples.block(0, 0, samples.getRows(), count);
+    const auto evaluation = samples.block(0, count, samples.getRows(), samples.getCols() - count);
+    const std::vector<int> calibrationLabels(test.getLabels().begin(), test.getLabels().begin() + count);
+    const std::vector<int> labels(test.getLabels().begin() + count, test.getLabels().end());
+
+    Cascade cascade;
+    std::vector<double> alone;
+    std::cout << std::fixed << std::setprecision(2);
+    for (const auto& modelFile : modelFiles) {
+        auto model = Cascade::load(modelFile);
+        int success = 0, label;
+        auto start = std::chrono::steady_clock::now();
+        for (int j = 0; j < evaluation.getCols(); ++j) {
+            Cascade::margin(model(evaluation.column(j)), label);
+            success += (label == labels[j]);
+        }
+        std::chrono::duration<double, std::micro> elapsed = std::chrono::steady_clock::now() - start;
+        alone.push_back(elapsed.count() / evaluation.getCols());
+        std::cout << modelFile << ": " << 100.0 * success / evaluation.getCols() << "% " << alone.back() << "us/query\n";
+        cascade.add(modelFile, model);
+    }
+
+    const auto calibrated = cascade.calibrate(calibration, calibrationLabels, target);
+    std::cout << "calibrated on " << count << " samples for " << target << "%: " << calibrated << "%, thresholds";
+    for (int s = 0; s + 1 < cascade.getStages(); ++s) {
+        std::cout << ' ' << std::setprecision(4) << cascade.getThreshold(s);
+    }
+    std::cout << std::setprecision(2) << '\n';
+
+    int success = 0;
+    auto start = std::chrono::steady_clock::now();
+    for (int j = 0; j < evaluation.getCols(); ++j) {
+        success += (cascade.query(evaluation.column(j)).label == labels[j]);
+    }
+    std::chrono::duration<double, std::micro> elapsed = std::chrono::steady_clock::now() - start;
+    const double latency = elapsed.count() / evaluation.getCols();
+
+    std::cout << "cascade on " << evaluation.getCols() << " samples: " << 100.0 * success / evaluation.getCols() << "% "
+              << latency << "us/query, " << alone.back() - latency << "us/query saved ("
+              << 100 * (1 - latency / alone.back()) << "%)\n";
+    for (int s = 0; s < cascade.getStages(); ++s) {
+        std::cout << "  " << cascade.getName(s) << " answered " << 100.0 * cascade.getAnswered(s) / evaluation.getCols() << "%\n";
+    }
+    std::cout << "escalation rate " << 100.0 * (evaluation.getCols() - cascade.getAnswered(0)) / evaluation.getCols() << "%\n";
+}
+
+void finetune_test(const std::string& modelFile, const std::string& trainFile, const std::string& testFile, const int& count, const int& epoch, const std::string& cacheFile)
+{
+    const auto model = DnnModel::loadModel(modelFile);
+    std::cout << std::fixed << std::setprecision(2);
+
+    // Every epoch re-reads the CSV and runs the frozen layers.
+    DNN full(model);
+    for (int i = 0; i + 1 < int(model.m_weights.size()); ++i) {
+        full.freeze(i);
+    }
+    auto start = std::chrono::steady_clock::now();
+    train(full, trainFile, count, epoch, false);
+    std::chrono::duration<double> uncached = std::chrono::steady_clock::now() - start;
+    const auto reference = evaluate(full, testFile, count);
+    std::cout << "uncached: " << uncached.count() / epoch << "s/epoch, " << reference.accuracy << "%\n";
+
+    DNN tuned(model);
+    for (int i = 0; i + 1 < int(model.m_weights.size()); ++i) {
+        tuned.freeze(i);
+    }
+    start = std::chrono::steady_clock::now();
+    const CsvDataset csv(trainFile);
+    const std::vector<int> labels(csv.getLabels().begin(), csv.getLabels().begin() + count);
+    FeatureCache cache(tuned, csv.getSamples().block(0, 0, count, csv.getFeatures()), labels, cacheFile);
+    std::chrono::duration<double> build = std::chrono::steady_clock::now() - start;
+
+    start = std::chrono::steady_clock::now();
+    std::vector<double> target(10, 0.01);
+    for (int i = 0; i < epoch; ++i) {
+        for (int j = 0; j < cache.getRows(); ++j) {
+            target[labels[j]] = 0.99;
+            tuned.trainFrozen(cache.getSample(j), target);
+            target[labels[j]] = 0.01;
+        }
+    }
+    std::chrono::duration<double> cached = std::chrono::steady_clock::now() - start;
+    const auto result = evaluate(tuned, testFile, count);
+
+    std::cout << "cache: " << cache.getRows() << "x" << cache.getWidth() << " features, " << cache.getBytes() << " bytes"
+              << (cache.isMapped() ? (cache.isReused() ? ", mapped from " : ", mapped to ") + cacheFile : std::string())
+              << ", built in " << build.count() << "s\n";
+    std::cout << "cached: " << cached.count() / epoch << "s/epoch (x" << uncached.count() / cached.count() << "), "
+              << result.accuracy << "%\n";
+}
+
+// Holds every scheduler worker (and the injection queue) with tasks that
+// spin until released, then checks a reader still answers queries.
+int online_busy_test(const std::string& modelFile, const std::string& testFile, const int& count)
+{
+    const CsvDataset test(testFile);
+    OnlineLearner learner(DnnModel::loadModel(modelFile));
+    const int threads = Scheduler::instance().getConcurrency();
+    if (threads == 1) {
+        std::cout << "scheduler has no workers; run with DNN_THREADS=4 or more\n";
+        return 1;
+    }
+
+    std::atomic<bool> release{ false };
+    std::atomic<int> holding{ 0 };
+    std::thread holder([&] {
+        parallel_for(0, 4 * threads, 1, [&](const int&, const int&) {
+            ++holding;
+            while (!release.load()) {
+                std::this_thread::yield();
+            }
+        });
+    });
+    while (holding.load() < threads - 1) {
+        std::this_thread::yield();
+    }
+
+    std::atomic<long> answered{ 0 };
+    double slowest = 0;
+    std::thread reader([&] {
+        OnlineLearner::Reader reader(learner);
+        for (int j = 0; j < count; ++j) {
+            auto start = std::chrono::steady_clock::now();
+            reader.query(test.getSample(j % test.getRows()));
+            std::chrono::duration<double, std::micro> elapsed = std::chrono::steady_clock::now() - start;
+            slowest = std::max(slowest, elapsed.count());
+            ++answered;
+        }
+    });
+
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(10);
+    while (answered.load() < count && std::chrono::steady_clock::now() < deadline) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    const long done = answered.load();
+    release = true;
+    reader.join();
+    holder.join();
+
+    std::cout << std::fixed << std::setprecision(2);
+    std::cout << threads << " threads held busy: reader answered " << done << " of " << count
+              << " queries, slowest " << slowest << "us\n";
+    return done == count ? 0 : 1;
+}
+
+void tune_gemm(const int& batch, const std::vector<int>& topology)
+{
+    const char* names[] = { "nn", "tn", "nt" };
+    auto& tuning = GemmTuning::instance();
+    std::cout << "tuning " << tuning.getCpu() << '\n';
+    std::cout << std::fixed << std::setprecision(1);
+
+    for (const auto& result : GemmAutotuner().tune(topology, batch)) {
+        std::cout << names[int(result.kernel)] << ' ' << result.m << 'x' << result.n << 'x' << result.k
+                  << ": default " << result.defaultSeconds * 1e6 << "us, tuned " << result.tunedSeconds * 1e6
+                  << "us (grain " << result.config.grain << ", blockK " << result.config.blockK
+                  << ", order " << result.config.order << ")\n";
+    }
+    tuning.save();
+    std::cout << "saved to " << GemmTuning::path() << '\n';
+}
+
 int main(int argc, char* argv[])
 {
+    if (argc == 7 && std::string(argv[1]) == "prune") {
+        prune_test(argv[2], argv[3], argv[4], atoi(argv[5]), atoi(argv[6]));
+        return 0;
+    }
+
+    if (argc == 6 && std::string(argv[1]) == "lowrank") {
+        lowrank_test(argv[2], argv[3], atoi(argv[4]), atof(argv[5]));
+        return 0;
+    }
+
+    if (argc >= 10 && std::string(argv[1]) == "recompute") {
+        std::vector<int> topology;
+        for (int i = 8; i < argc; ++i) {
+            topology.push_back(atoi(argv[i]));
+        }
+        train_recomputing(argv[2], atoi(argv[3]), atoi(argv[4]), atoi(argv[5]), atoi(argv[6]), std::size_t(atol(argv[7])) << 10, topology);
+        return 0;
+    }
+
+    if (argc >= 10 && std::string(argv[1]) == "pipeline") {
+        std::vector<int> topology;
+        for (int i = 8; i < argc; ++i) {
+            topology.push_back(atoi(argv[i]));
+        }
+        train_pipeline(argv[2], atoi(argv[3]), atoi(argv[4]), atoi(argv[5]), atoi(argv[6]), atoi(argv[7]), topology);
+        return 0;
+    }
+
+    if (argc == 7 && std::string(argv[1]) == "augment") {
+        train_augmented(argv[2], argv[3], atoi(argv[4]), atoi(argv[5]), atoi(argv[6]));
+        return 0;
+    }
+
+    if (argc == 5 && std::string(argv[1]) == "half") {
+        half_test(argv[2], argv[3], atoi(argv[4]));
+        return 0;
+    }
+
+    if (argc == 7 && std::string(argv[1]) == "half") {
+        half_test(argv[2], argv[3], atoi(argv[4]), argv[5], atoi(argv[6]));
+        return 0;
+    }
+
+    if ((argc == 7 || argc == 8) && std::string(argv[1]) == "finetune") {
+        finetune_test(argv[2], argv[3], argv[4], atoi(argv[5]), atoi(argv[6]), argc == 8 ? argv[7] : "");
+        return 0;
+    }
+
+    if (argc >= 7 && std::string(argv[1]) == "cascade") {
+        cascade_test(argv[2], atoi(argv[3]), atof(argv[4]), std::vector<std::string>(argv + 5, argv + argc));
+        return 0;
+    }
+
+    if (argc >= 6 && std::string(argv[1]) == "ensemble") {
+        ensemble_test(argv[2], atoi(argv[3]), argv[4], std::vector<std::string>(argv + 5, argv + argc));
+        return 0;
+    }
+
+    if (argc == 5 && std::string(argv[1]) == "onlinebusy") {
+        return online_busy_test(argv[2], argv[3], atoi(argv[4]));
+    }
+
+    if (argc == 7 && std::string(argv[1]) == "online") {
+        train_online(argv[2], argv[3], argv[4], atoi(argv[5]), atoi(argv[6]));
+        return 0;
+    }
+
+    if (argc == 7 && std::string(argv[1]) == "checkpoint") {
+        train_checkpointed(argv[2], atoi(argv[3]), atoi(argv[4]), argv[5], atoi(argv[6]));
+        return 0;
+    }
+
+    if (argc == 5 && std::string(argv[1]) == "stream") {
+        train_stream(argv[2], atoi(argv[3]), atoi(argv[4]));
+        return 0;
+    }
+
+    if (argc == 6 && std::string(argv[1]) == "cnn") {
+        learn_cnn(argv[2], argv[3], atoi(argv[4]), atoi(argv[5]));
+        return 0;
+    }
+
+    if (argc == 3 && std::string(argv[1]) == "convbench") {
+        conv_bench(atoi(argv[2]));
+        return 0;
+    }
+
+    if (argc == 3 && std::string(argv[1]) == "csv") {
+        csv_bench(argv[2]);
+        return 0;
+    }
+
+    if (argc == 6 && std::string(argv[1]) == "executor") {
+        train_executor(argv[2], atoi(argv[3]), atoi(argv[4]), atoi(argv[5]));
+        return 0;
+    }
+
+    if (argc == 7 && std::string(argv[1]) == "distributed") {
+        const std::string fileName = argv[2];
+        const auto count = atoi(argv[3]), epoch = atoi(argv[4]), size = atoi(argv[5]), batch = atoi(argv[6]);
+        return launch(size, [&](const int& rank) {
+            return distributed_worker(fileName, count, epoch, batch, rank, size, "127.0.0.1", 29500);
+        }) ? 0 : 1;
+    }
+
+    if (argc == 10 && std::string(argv[1]) == "worker") {
+        return distributed_worker(argv[2], atoi(argv[3]), atoi(argv[4]), atoi(argv[5]),
+                                  atoi(argv[6]), atoi(argv[7]), argv[8], atoi(argv[9]));
+    }
+
+    if (argc >= 5 && std::string(argv[1]) == "tune") {
+        std::vector<int> topology;
+        for (int i = 3; i < argc; ++i) {
+            topology.push_back(atoi(argv[i]));
+        }
+        tune_gemm(atoi(argv[2]), topology);
+        return 0;
+    }
+
+    if (argc == 6 && std::string(argv[1]) == "serve") {
+        serve_bench(argv[2], argv[3], atoi(argv[4]), atoi(argv[5]));
+        return 0;
+    }
+
+    if (argc == 4 && std::string(argv[1]) == "compile") {
+        const std::string prefix = argv[3];
+        const auto slash = prefix.find_last_of('/');
+        Compiler(DnnModel::loadModel(argv[2]), prefix.substr(slash == std::string::npos ? 0 : slash + 1)).compile(prefix);
+        return 0;
+    }
+
+    if (argc == 4 && std::string(argv[1]) == "reverse") {
+        DNN neural = DnnModel::loadModel(argv[2]);
+        reverse_sheet(neural, argv[3]);
+        return 0;
+    }
+
     if (argc != 4) {
     	std::cout << "Not enough arguments were provided";
 	return -1;
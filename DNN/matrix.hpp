@@ -1,7 +1,9 @@
 #ifndef MATRIX_HPP
 #define MATRIX_HPP
 
+#include "kernels.hpp"
 #include <iostream>
+#include <algorithm>
 #include <memory>
 #include <vector>
 
@@ -19,15 +21,13 @@ public:
 
     Matrix<T>& operator=(const Matrix<T>& other) {
 
+        if(!m_data || m_rows * m_cols != other.getRows() * other.getCols()) {
+            m_data = std::make_unique<T[]>(other.getRows() * other.getCols());
+        }
         m_rows = other.getRows();
         m_cols = other.getCols();
-        m_data = std::make_unique<T[]>(m_rows * m_cols);
 
-        for(int i=0; i<m_rows; ++i) {
-            for(int j=0; j<m_cols; ++j) {
-                (*this)[i][j] = other[i][j];
-            }
-        }
+        std::copy(other.data(), other.data() + m_rows * m_cols, m_data.get());
 
         return *this;
     }
@@ -51,6 +51,22 @@ public:
         return m_cols;
     }
 
+    void reshape(const int& rows, const int& cols) {
+        if(rows*cols != m_rows*m_cols) {
+            throw std::length_error("reshape must keep the number of elements");
+        }
+        m_rows = rows;
+        m_cols = cols;
+    }
+
+    T* data() {
+        return m_data.get();
+    }
+
+    const T* data() const {
+        return m_data.get();
+    }
+
     static auto identity(const int& rows, const int& cols) {
         Matrix<T> iden(rows, cols);
         for(int i=0; i<rows; ++i) {
@@ -62,12 +78,9 @@ public:
     }
 
     auto transpose() const {
+        PROFILE_SCOPE("transpose");
         Matrix<T> matrix(m_cols, m_rows);
-        for(int i=0; i<m_cols; ++i) {
-            for(int j=0; j<m_rows; ++j) {
-                matrix[i][j] = (*this)[j][i];
-            }
-        }
+        ::transpose(m_rows, m_cols, data(), m_cols, matrix.data(), m_rows);
         return matrix;
     }
 
@@ -159,13 +172,7 @@ public:
         }
 
         Matrix<T> mat(m_rows, other.getCols());
-        for(int i=0; i<m_rows; ++i) {
-            for(int j=0; j<other.getCols(); ++j) {
-                for(int k=0; k<m_cols; ++k) {
-                    mat[i][j] += (*this)[i][k] * other[k][j];
-                }
-            }
-        }
+        gemm(m_rows, other.getCols(), m_cols, data(), other.data(), mat.data(), true);
         return mat;
     }
 private:
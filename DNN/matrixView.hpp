@@ -0,0 +1,209 @@
+#ifndef MATRIX_VIEW_HPP
+#define MATRIX_VIEW_HPP
+
+#include "matrix.hpp"
+#include "kernels.hpp"
+#include <vector>
+#include <stdexcept>
+
+// Non-owning window onto row/column strided memory. Element (i, j) lives
+// at data[i*rowStride + j*colStride], so sub-blocks, single rows or
+// columns and transposes are all views of the same buffer.
+template<typename T>
+class MatrixView {
+public:
+    MatrixView(T* data, const int& rows, const int& cols, const int& rowStride, const int& colStride = 1)
+    :   m_data(data),
+        m_rows(rows),
+        m_cols(cols),
+        m_rowStride(rowStride),
+        m_colStride(colStride) {}
+
+    MatrixView(Matrix<T>& matrix)
+    :   MatrixView(matrix.data(), matrix.getRows(), matrix.getCols(), matrix.getCols()) {}
+
+    MatrixView(std::vector<T>& list)
+    :   MatrixView(list.data(), list.size(), 1, 1) {}
+
+    const int& getRows() const {
+        return m_rows;
+    }
+
+    const int& getCols() const {
+        return m_cols;
+    }
+
+    const int& getRowStride() const {
+        return m_rowStride;
+    }
+
+    const int& getColStride() const {
+        return m_colStride;
+    }
+
+    T* data() const {
+        return m_data;
+    }
+
+    T& operator()(const int& i, const int& j) const {
+        return m_data[i*m_rowStride + j*m_colStride];
+    }
+
+    MatrixView block(const int& row, const int& col, const int& rows, const int& cols) const {
+        if(row < 0 || col < 0 || row + rows > m_rows || col + cols > m_cols) {
+            throw std::length_error("block outside of the matrix");
+        }
+        return MatrixView(&(*this)(row, col), rows, cols, m_rowStride, m_colStride);
+    }
+
+    MatrixView row(const int& i) const {
+        return block(i, 0, 1, m_cols);
+    }
+
+    MatrixView column(const int& j) const {
+        return block(0, j, m_rows, 1);
+    }
+
+    MatrixView transpose() const {
+        return MatrixView(m_data, m_cols, m_rows, m_colStride, m_rowStride);
+    }
+
+    Matrix<T> copy() const {
+        Matrix<T> mat(m_rows, m_cols);
+        for(int i=0; i<m_rows; ++i) {
+            for(int j=0; j<m_cols; ++j) {
+                mat[i][j] = (*this)(i, j);
+            }
+        }
+        return mat;
+    }
+private:
+    T* m_data;
+    int m_rows, m_cols;
+    int m_rowStride, m_colStride;
+};
+
+template<typename T>
+class ConstMatrixView {
+public:
+    ConstMatrixView(const T* data, const int& rows, const int& cols, const int& rowStride, const int& colStride = 1)
+    :   m_data(data),
+        m_rows(rows),
+        m_cols(cols),
+        m_rowStride(rowStride),
+        m_colStride(colStride) {}
+
+    ConstMatrixView(const Matrix<T>& matrix)
+    :   ConstMatrixView(matrix.data(), matrix.getRows(), matrix.getCols(), matrix.getCols()) {}
+
+    ConstMatrixView(const std::vector<T>& list)
+    :   ConstMatrixView(list.data(), list.size(), 1, 1) {}
+
+    ConstMatrixView(const MatrixView<T>& view)
+    :   ConstMatrixView(view.data(), view.getRows(), view.getCols(), view.getRowStride(), view.getColStride()) {}
+
+    const int& getRows() const {
+        return m_rows;
+    }
+
+    const int& getCols() const {
+        return m_cols;
+    }
+
+    const int& getRowStride() const {
+        return m_rowStride;
+    }
+
+    const int& getColStride() const {
+        return m_colStride;
+    }
+
+    const T* data() const {
+        return m_data;
+    }
+
+    const T& operator()(const int& i, const int& j) const {
+        return m_data[i*m_rowStride + j*m_colStride];
+    }
+
+    ConstMatrixView block(const int& row, const int& col, const int& rows, const int& cols) const {
+        if(row < 0 || col < 0 || row + rows > m_rows || col + cols > m_cols) {
+            throw std::length_error("block outside of the matrix");
+        }
+        return ConstMatrixView(&(*this)(row, col), rows, cols, m_rowStride, m_colStride);
+    }
+
+    ConstMatrixView row(const int& i) const {
+        return block(i, 0, 1, m_cols);
+    }
+
+    ConstMatrixView column(const int& j) const {
+        return block(0, j, m_rows, 1);
+    }
+
+    ConstMatrixView transpose() const {
+        return ConstMatrixView(m_data, m_cols, m_rows, m_colStride, m_rowStride);
+    }
+
+    Matrix<T> copy() const {
+        Matrix<T> mat(m_rows, m_cols);
+        for(int i=0; i<m_rows; ++i) {
+            for(int j=0; j<m_cols; ++j) {
+                mat[i][j] = (*this)(i, j);
+            }
+        }
+        return mat;
+    }
+private:
+    const T* m_data;
+    int m_rows, m_cols;
+    int m_rowStride, m_colStride;
+};
+
+// c = alpha * a * b, or c += alpha * a * b when accumulate is set. Picks
+// the kernel whose inner loop runs over unit stride memory; anything else
+// falls back to a plain strided loop.
+template<typename T>
+void gemm(const ConstMatrixView<T>& a, const ConstMatrixView<T>& b, const MatrixView<T>& c, const T& alpha = 1, const bool& accumulate = false) {
+    if(a.getCols() != b.getRows() || c.getRows() != a.getRows() || c.getCols() != b.getCols()) {
+        throw std::length_error("mismatched matrix for dot product. Dimensions not correct\n");
+    }
+
+    const int m = c.getRows(), n = c.getCols(), k = a.getCols();
+    auto unitCols = [](const auto& view) { return view.getColStride() == 1 || view.getCols() == 1; };
+    auto unitRows = [](const auto& view) { return view.getRowStride() == 1 || view.getRows() == 1; };
+
+    if(unitCols(c)) {
+        if(unitCols(a) && unitCols(b)) {
+            gemmNN(m, n, k, alpha, a.data(), a.getRowStride(), b.data(), b.getRowStride(), c.data(), c.getRowStride(), accumulate);
+            return;
+        }
+        if(unitCols(a) && unitRows(b)) {
+            gemmNT(m, n, k, alpha, a.data(), a.getRowStride(), b.data(), b.getColStride(), c.data(), c.getRowStride(), accumulate);
+            return;
+        }
+        if(unitRows(a) && unitCols(b)) {
+            gemmTN(m, n, k, alpha, a.data(), a.getColStride(), b.data(), b.getRowStride(), c.data(), c.getRowStride(), accumulate);
+            return;
+        }
+    }
+
+    for(int i=0; i<m; ++i) {
+        for(int j=0; j<n; ++j) {
+            T sum = T();
+            for(int p=0; p<k; ++p) {
+                sum += a(i, p) * b(p, j);
+            }
+            c(i, j) = (accumulate? c(i, j): T()) + alpha * sum;
+        }
+    }
+}
+
+template<typename T>
+Matrix<T> dot(const ConstMatrixView<T>& a, const ConstMatrixView<T>& b) {
+    Matrix<T> mat(a.getRows(), b.getCols());
+    gemm<T>(a, b, mat);
+    return mat;
+}
+
+#endif
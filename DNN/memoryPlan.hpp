@@ -0,0 +1,110 @@
+#ifndef MEMORY_PLAN_HPP
+#define MEMORY_PLAN_HPP
+
+#include <vector>
+#include <string>
+#include <algorithm>
+#include <numeric>
+#include <iostream>
+#include <iomanip>
+#include <stdexcept>
+
+// Static placement of buffers into one arena. Every buffer is live from
+// the step that writes it first to the step that reads it last, and two
+// buffers may share memory when those intervals do not overlap. Placement
+// is greedy: largest buffer first, at the lowest offset that is free for
+// its whole lifetime.
+class MemoryPlan {
+public:
+    int add(const std::string& name, const std::size_t& size, const int& first, const int& last) {
+        if(first > last) {
+            throw std::invalid_argument(name + ": buffer dies before it is written");
+        }
+        m_buffers.push_back({ name, size, first, last, 0 });
+        m_planned = false;
+        return m_buffers.size() - 1;
+    }
+
+    void plan() {
+        std::vector<int> order(m_buffers.size());
+        std::iota(order.begin(), order.end(), 0);
+        std::stable_sort(order.begin(), order.end(), [this](const int& a, const int& b) {
+            return m_buffers[a].size > m_buffers[b].size;
+        });
+
+        std::vector<int> placed;
+        m_peak = 0;
+        for(auto id: order) {
+            auto& buffer = m_buffers[id];
+
+            std::vector<const Buffer*> conflicts;
+            for(auto other: placed) {
+                const auto& o = m_buffers[other];
+                if(o.first <= buffer.last && buffer.first <= o.last) {
+                    conflicts.push_back(&o);
+                }
+            }
+            std::sort(conflicts.begin(), conflicts.end(), [](const Buffer* a, const Buffer* b) {
+                return a->offset < b->offset;
+            });
+
+            std::size_t offset = 0;
+            for(auto o: conflicts) {
+                if(offset + buffer.size <= o->offset) {
+                    break;
+                }
+                offset = std::max(offset, o->offset + o->size);
+            }
+
+            buffer.offset = offset;
+            m_peak = std::max(m_peak, offset + buffer.size);
+            placed.push_back(id);
+        }
+        m_planned = true;
+    }
+
+    const std::size_t& getOffset(const int& id) const {
+        if(!m_planned) {
+            throw std::logic_error("memory plan has not been computed");
+        }
+        return m_buffers[id].offset;
+    }
+
+    const std::size_t& getPeak() const {
+        return m_peak;
+    }
+
+    std::size_t getUnplannedSize() const {
+        std::size_t total = 0;
+        for(const auto& buffer: m_buffers) {
+            total += buffer.size;
+        }
+        return total;
+    }
+
+    void print(std::ostream& os, const std::size_t& elementSize = sizeof(double)) const {
+        os << std::left << std::setw(16) << "buffer" << std::right << std::setw(12) << "offset"
+           << std::setw(12) << "bytes" << "  steps\n";
+        for(const auto& buffer: m_buffers) {
+            os << std::left << std::setw(16) << buffer.name << std::right
+               << std::setw(12) << buffer.offset * elementSize
+               << std::setw(12) << buffer.size * elementSize
+               << "  " << buffer.first << '-' << buffer.last << '\n';
+        }
+        os << "peak " << m_peak * elementSize << " bytes, "
+           << getUnplannedSize() * elementSize << " bytes without sharing\n";
+    }
+private:
+    struct Buffer {
+        std::string name;
+        std::size_t size;
+        int first, last;
+        std::size_t offset;
+    };
+
+    std::vector<Buffer> m_buffers;
+    std::size_t m_peak = 0;
+    bool m_planned = false;
+};
+
+#endif
@@ -1,11 +1,12 @@
 #ifndef MNIST_HPP
 #define MNIST_HPP
 
+#include "scheduler.hpp"
+#include "csvDataset.hpp"
 #include <opencv4/imgproc.hpp>
 #include <opencv4/imgcodecs.hpp>
 #include <opencv4/highgui.hpp>
 #include <fstream>
-#include <sstream>
 
 struct MnistData {
     int label;
@@ -35,22 +36,32 @@ public:
         std::string line;
         m_file >> line;
 
-        char skip;
-        int col;
-
-        std::stringstream ss(line);
-        ss >> col >> skip;
+        parse(line, m_mnistData);
+        
+        return m_mnistData;   
+    }
 
-        m_mnistData.label = col;
+    std::vector<MnistData> getNextBatch(const int& count) {
+        std::vector<std::string> lines(count);
+        for(auto& line: lines) {
+            m_file >> line;
+        }
 
-        m_mnistData.pixels.clear();
+        std::vector<MnistData> batch(count);
+        parallel_for(0, count, 64, [&](const int& first, const int& last) {
+            for(int i=first; i<last; ++i) {
+                parse(lines[i], batch[i]);
+            }
+        });
+        return batch;
+    }
 
-        for(int i=0; i<28*28; ++i) {
-            ss >> col >> skip;
-            m_mnistData.pixels.push_back((col/255.0 * 0.99) + 0.01);
+    static void parse(const std::string& line, MnistData& data) {
+        PROFILE_SCOPE("parse");
+        data.pixels.resize(28*28);
+        if(!parseCsvRecord(line.data(), line.data() + line.size(), data.label, data.pixels.data(), 28*28)) {
+            throw std::runtime_error("malformed MNIST record");
         }
-        
-        return m_mnistData;   
     }
 
     void draw() {
@@ -78,6 +89,14 @@ public:
     void reset() {
         m_file.seekg(0, std::ios::beg);
     }
+
+    std::streamoff tell() {
+        return m_file.tellg();
+    }
+
+    void seek(const std::streamoff& offset) {
+        m_file.seekg(offset, std::ios::beg);
+    }
 private:
     std::ifstream m_file;
     MnistData m_mnistData;
@@ -0,0 +1,243 @@
+#ifndef ONLINE_LEARNER_HPP
+#define ONLINE_LEARNER_HPP
+
+#include "dnn.hpp"
+#include "inferenceSession.hpp"
+#include "scheduler.hpp"
+#include <atomic>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <deque>
+#include <vector>
+#include <limits>
+#include <stdexcept>
+
+// Keeps training a model on a stream of samples while other threads query
+// it. One trainer thread owns a private DNN; every publishInterval samples
+// it freezes the weights into a new immutable snapshot and swaps it in
+// with a single atomic store, so a reader sees either the old or the new
+// weights as a whole and never waits for the trainer.
+//
+// Old snapshots are reclaimed by epochs: a reader announces the global
+// epoch before it loads the snapshot pointer and clears it when done, and a
+// retired snapshot is only deleted once every announced epoch is newer
+// than the one it was retired in.
+class OnlineLearner {
+private:
+    struct Snapshot {
+        Snapshot(const DnnModel& model, const long& version)
+        :   session(model),
+            version(version) {}
+
+        InferenceSession session;
+        long version;
+    };
+
+    struct Retired {
+        const Snapshot* snapshot;
+        unsigned long epoch;
+    };
+
+    struct Sample {
+        std::vector<double> input;
+        std::vector<double> target;
+    };
+
+    static constexpr int maxReaders = 64;
+    static constexpr unsigned long quiescent = 0;
+public:
+    // Per thread query handle. Queries are wait free: two atomic stores,
+    // two atomic loads and the forward pass, which runs serially on the
+    // calling thread so it never queues behind the trainer's tasks.
+    class Reader {
+    public:
+        Reader(OnlineLearner& learner)
+        :   m_learner(learner),
+            m_slot(learner.claimSlot()) {}
+
+        Reader(const Reader&) = delete;
+        Reader& operator=(const Reader&) = delete;
+
+        ~Reader() {
+            m_learner.m_slots[m_slot].epoch.store(quiescent);
+            m_learner.m_slots[m_slot].used.store(false);
+        }
+
+        // Outputs stay valid until this reader's next query.
+        ConstMatrixView<double> query(const ConstMatrixView<double>& input) {
+            SerialRegion serial;
+            auto& epoch = m_learner.m_slots[m_slot].epoch;
+            epoch.store(m_learner.m_epoch.load());
+            const Snapshot* snapshot = m_learner.m_current.load();
+            auto output = snapshot->session.query(m_context, input);
+            m_version = snapshot->version;
+            epoch.store(quiescent);
+            return output;
+        }
+
+        // Version of the snapshot that answered the last query.
+        const long& getVersion() const {
+            return m_version;
+        }
+    private:
+        OnlineLearner& m_learner;
+        int m_slot;
+        InferenceSession::Context m_context;
+        long m_version = 0;
+    };
+
+    OnlineLearner(const DnnModel& model, const int& publishInterval = 1000, const std::size_t& queueCapacity = 4096)
+    :   m_trainer(model),
+        m_publishInterval(publishInterval),
+        m_queueCapacity(queueCapacity),
+        m_current(new Snapshot(model, 0)) {
+
+        if(publishInterval < 1) {
+            throw std::invalid_argument("publish interval must be atleast one sample");
+        }
+        m_thread = std::thread(&OnlineLearner::run, this);
+    }
+
+    OnlineLearner(const OnlineLearner&) = delete;
+    OnlineLearner& operator=(const OnlineLearner&) = delete;
+
+    ~OnlineLearner() {
+        stop();
+        reclaim(std::numeric_limits<unsigned long>::max());
+        delete m_current.load();
+    }
+
+    // Queues a labelled sample for the trainer. Blocks while the queue is
+    // full so a fast producer cannot outrun training without bound.
+    void submit(std::vector<double> input, std::vector<double> target) {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        m_space.wait(lock, [this] { return m_queue.size() < m_queueCapacity || m_stop; });
+        if(m_stop) {
+            throw std::logic_error("online learner has been stopped");
+        }
+        m_queue.push_back({ std::move(input), std::move(target) });
+        m_available.notify_one();
+    }
+
+    // Trains on everything already queued, publishes the result and stops
+    // the trainer. Readers keep working on the final snapshot.
+    void stop() {
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            if(m_stop) {
+                return;
+            }
+            m_stop = true;
+        }
+        m_available.notify_all();
+        m_space.notify_all();
+        m_thread.join();
+    }
+
+    // Latest published version. Read from its own atomic: the snapshot
+    // itself may be reclaimed by the trainer at any time.
+    long getVersion() const {
+        return m_version.load();
+    }
+
+    long getTrained() const {
+        return m_trained.load();
+    }
+
+    // The trainer's weights; only meaningful once stop() has returned.
+    DnnModel getModel() const {
+        return m_trainer.getModel();
+    }
+private:
+    struct alignas(64) Slot {
+        std::atomic<bool> used{false};
+        std::atomic<unsigned long> epoch{quiescent};
+    };
+
+    int claimSlot() {
+        for(int i=0; i<maxReaders; ++i) {
+            bool expected = false;
+            if(m_slots[i].used.compare_exchange_strong(expected, true)) {
+                return i;
+            }
+        }
+        throw std::length_error("too many concurrent readers");
+    }
+
+    void run() {
+        long sinceLast = 0;
+        for(;;) {
+            Sample sample;
+            {
+                std::unique_lock<std::mutex> lock(m_mutex);
+                m_available.wait(lock, [this] { return m_stop || !m_queue.empty(); });
+                if(m_queue.empty()) {
+                    break;
+                }
+                sample = std::move(m_queue.front());
+                m_queue.pop_front();
+            }
+            m_space.notify_one();
+
+            m_trainer.train(sample.input, sample.target);
+            ++m_trained;
+            if(++sinceLast == m_publishInterval) {
+                publish();
+                sinceLast = 0;
+            }
+        }
+        if(sinceLast > 0) {
+            publish();
+        }
+    }
+
+    void publish() {
+        auto snapshot = new Snapshot(m_trainer.getModel(), m_current.load()->version + 1);
+        const Snapshot* old = m_current.exchange(snapshot);
+        m_version.store(snapshot->version);
+        m_retired.push_back({ old, m_epoch.fetch_add(1) });
+
+        unsigned long oldest = std::numeric_limits<unsigned long>::max();
+        for(const auto& slot: m_slots) {
+            const auto epoch = slot.epoch.load();
+            if(epoch != quiescent) {
+                oldest = std::min(oldest, epoch);
+            }
+        }
+        reclaim(oldest);
+    }
+
+    // Deletes the snapshots retired before epoch oldest.
+    void reclaim(const unsigned long& oldest) {
+        auto kept = m_retired.begin();
+        for(auto& retired: m_retired) {
+            if(retired.epoch < oldest) {
+                delete retired.snapshot;
+            } else {
+                *kept++ = retired;
+            }
+        }
+        m_retired.erase(kept, m_retired.end());
+    }
+private:
+    DNN m_trainer;
+    int m_publishInterval;
+    std::size_t m_queueCapacity;
+
+    std::atomic<const Snapshot*> m_current;
+    std::atomic<unsigned long> m_epoch{1};
+    Slot m_slots[maxReaders];
+    std::vector<Retired> m_retired;
+    std::atomic<long> m_trained{0};
+    std::atomic<long> m_version{0};
+
+    std::deque<Sample> m_queue;
+    bool m_stop = false;
+    std::mutex m_mutex;
+    std::condition_variable m_available;
+    std::condition_variable m_space;
+    std::thread m_thread;
+};
+
+#endif
@@ -0,0 +1,364 @@
+#ifndef PIPELINE_TRAINER_HPP
+#define PIPELINE_TRAINER_HPP
+
+#include "matrixView.hpp"
+#include "activation.hpp"
+#include "dnnModel.hpp"
+#include "spscQueue.hpp"
+#include <vector>
+#include <memory>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <iostream>
+#include <cmath>
+#include <stdexcept>
+
+// Trains a dense sigmoid network with its layers split over threads. Each
+// stage owns a contiguous range of layers (balanced by weight count) and
+// only its own slice of the weights. A batch is cut into micro-batches
+// that flow forward from stage to stage and their errors flow back, over
+// single producer queues between neighbours. The queues only carry the
+// index of a buffer the link between the two stages owns, and a second
+// queue hands it back once both sides are done with it, so no matrix is
+// allocated or copied once the trainer is built: a stage's last layer
+// writes its activations straight into a link buffer, which the next
+// stage reads as its input.
+//
+// Stages follow the 1F1B schedule: stage s of S first runs S-1-s forward
+// passes to fill the pipe, then alternates one forward and one backward
+// pass, then drains the remaining backward passes. That keeps at most
+// S-s micro-batches of activations alive per stage. Gradients are summed
+// over the whole batch and applied once every stage has drained, so a
+// batch makes the same update as Executor::train on the whole batch.
+class PipelineTrainer {
+public:
+    PipelineTrainer(const DnnModel& model, const int& stages, const int& microBatch)
+    :   m_learningRate(model.m_learningRate),
+        m_microBatch(microBatch) {
+
+        const int L = model.m_weights.size();
+        if(L == 0) {
+            throw std::length_error("Network needs atleast two layers.");
+        }
+        if(stages < 1 || stages > L) {
+            throw std::invalid_argument("need between one stage and one stage per layer");
+        }
+        if(microBatch < 1) {
+            throw std::invalid_argument("micro-batches need atleast one sample");
+        }
+        for(int i=1; i<L; ++i) {
+            if(model.m_weights[i].getCols() != model.m_weights[i-1].getRows()) {
+                throw std::length_error("mismatched layer sizes in model");
+            }
+        }
+
+        long remaining = 0;
+        for(const auto& weight: model.m_weights) {
+            remaining += long(weight.getRows()) * weight.getCols();
+        }
+        int layer = 0;
+        for(int s=0; s<stages; ++s) {
+            const long target = remaining / (stages - s);
+            const int first = layer;
+            long size = 0;
+            do {
+                size += long(model.m_weights[layer].getRows()) * model.m_weights[layer].getCols();
+                ++layer;
+            } while(layer < L - (stages - s - 1) &&
+                    size + long(model.m_weights[layer].getRows()) * model.m_weights[layer].getCols() / 2 <= target);
+            remaining -= size;
+
+            auto stage = std::make_unique<Stage>();
+            stage->first = first;
+            stage->weights.assign(model.m_weights.begin() + first, model.m_weights.begin() + layer);
+            for(const auto& weight: stage->weights) {
+                stage->gradients.emplace_back(weight.getRows(), weight.getCols());
+                stage->deltas.emplace_back(weight.getRows(), microBatch);
+                stage->errors.emplace_back(weight.getCols(), microBatch);
+            }
+            stage->error = Matrix<double>(stage->weights.back().getRows(), microBatch);
+            const int inFlight = stages - s;
+            const int kept = stage->weights.size() - (s + 1 < stages);
+            stage->outputs.resize(inFlight);
+            stage->received.assign(inFlight, -1);
+            stage->sent.assign(inFlight, -1);
+            for(int k=0; k<inFlight; ++k) {
+                for(int i=0; i<kept; ++i) {
+                    stage->outputs[k].emplace_back(stage->weights[i].getRows(), microBatch);
+                }
+            }
+            m_stages.push_back(std::move(stage));
+        }
+
+        for(int s=0; s+1<stages; ++s) {
+            const int rows = m_stages[s]->weights.back().getRows();
+            m_forward.push_back(std::make_unique<Link>(rows, microBatch, stages + 1));
+            m_backward.push_back(std::make_unique<Link>(rows, microBatch, stages + 1));
+        }
+        for(int s=0; s<stages; ++s) {
+            m_threads.emplace_back(&PipelineTrainer::run, this, s);
+        }
+    }
+
+    PipelineTrainer(const PipelineTrainer&) = delete;
+    PipelineTrainer& operator=(const PipelineTrainer&) = delete;
+
+    ~PipelineTrainer() {
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_stop = true;
+        }
+        m_start.notify_all();
+        for(auto& thread: m_threads) {
+            thread.join();
+        }
+    }
+
+    // Inputs are (inputs x batch) and targets (outputs x batch); batch must
+    // be a multiple of the micro-batch size.
+    void train(const ConstMatrixView<double>& input, const ConstMatrixView<double>& target) {
+        const auto& front = m_stages.front()->weights.front();
+        const auto& back = m_stages.back()->weights.back();
+        if(input.getRows() != front.getCols() || target.getRows() != back.getRows() ||
+           input.getCols() != target.getCols() || input.getCols() % m_microBatch != 0) {
+            throw std::length_error("batch does not match the network or the micro-batch size");
+        }
+
+        std::unique_lock<std::mutex> lock(m_mutex);
+        m_input = input;
+        m_target = target;
+        m_microBatches = input.getCols() / m_microBatch;
+        m_squaredError = 0;
+        m_running = m_stages.size();
+        ++m_generation;
+        m_start.notify_all();
+        m_finished.wait(lock, [this] { return m_running == 0; });
+
+        m_error = std::sqrt(m_squaredError / (double(back.getRows()) * input.getCols()));
+    }
+
+    double getError() const {
+        return m_error;
+    }
+
+    int getStages() const {
+        return m_stages.size();
+    }
+
+    // Weights of every stage, in layer order. Only call between batches.
+    DnnModel getModel() const {
+        DnnModel model{m_learningRate, {}};
+        for(const auto& stage: m_stages) {
+            model.m_weights.insert(model.m_weights.end(), stage->weights.begin(), stage->weights.end());
+        }
+        return model;
+    }
+
+    void print(std::ostream& out) const {
+        for(int s=0; s<m_stages.size(); ++s) {
+            const auto& stage = *m_stages[s];
+            long size = 0;
+            for(const auto& weight: stage.weights) {
+                size += long(weight.getRows()) * weight.getCols();
+            }
+            out << "stage " << s << ": layers " << stage.first << "-" << stage.first + stage.weights.size() - 1
+                << ", " << size << " weights\n";
+        }
+    }
+private:
+    struct Stage {
+        int first;
+        std::vector<Matrix<double>> weights;
+        std::vector<Matrix<double>> gradients;
+        std::vector<Matrix<double>> deltas;
+        std::vector<Matrix<double>> errors;
+        // target - output of the last stage.
+        Matrix<double> error;
+        // Per in-flight slot: every layer's activations, except the last
+        // layer of a stage that sends them on, and the forward link
+        // buffers the slot reads its input from and sends its output in.
+        std::vector<std::vector<Matrix<double>>> outputs;
+        std::vector<int> received;
+        std::vector<int> sent;
+    };
+
+    // Fixed buffers between two neighbouring stages. ready carries the
+    // indices of filled buffers to the receiver in order; free carries
+    // them back to the sender once they are no longer read. A forward
+    // buffer is read by both stages until the sender's backward pass, which
+    // comes after the receiver's, so the sender frees it itself.
+    struct Link {
+        Link(const int& rows, const int& cols, const int& count)
+        :   ready(count),
+            free(count) {
+            for(int i=0; i<count; ++i) {
+                buffers.emplace_back(rows, cols);
+                free.push(i);
+            }
+        }
+
+        std::vector<Matrix<double>> buffers;
+        SpscQueue<int> ready;
+        SpscQueue<int> free;
+    };
+
+    void run(const int& s) {
+        long seen = 0;
+        for(;;) {
+            {
+                std::unique_lock<std::mutex> lock(m_mutex);
+                m_start.wait(lock, [&] { return m_stop || m_generation != seen; });
+                if(m_stop) {
+                    return;
+                }
+                seen = m_generation;
+            }
+
+            const int stages = m_stages.size();
+            const int warmup = std::min(stages - 1 - s, m_microBatches);
+            int forwards = 0, backwards = 0;
+            for(; forwards<warmup; ++forwards) {
+                forward(s, forwards);
+            }
+            while(backwards < m_microBatches) {
+                if(forwards < m_microBatches) {
+                    forward(s, forwards++);
+                }
+                backward(s, backwards++);
+            }
+
+            auto& stage = *m_stages[s];
+            for(int k=0; k<stage.weights.size(); ++k) {
+                stage.weights[k] += m_learningRate * stage.gradients[k];
+                std::fill(stage.gradients[k].data(), stage.gradients[k].data() + stage.gradients[k].getRows()*stage.gradients[k].getCols(), 0.0);
+            }
+
+            std::lock_guard<std::mutex> lock(m_mutex);
+            if(--m_running == 0) {
+                m_finished.notify_one();
+            }
+        }
+    }
+
+    ConstMatrixView<double> stageInput(const int& s, const int& id) {
+        if(s == 0) {
+            return m_input.block(0, id * m_microBatch, m_input.getRows(), m_microBatch);
+        }
+        const auto& stage = *m_stages[s];
+        return m_forward[s-1]->buffers[stage.received[id % (m_stages.size() - s)]];
+    }
+
+    // Layer k's activations for a slot.
+    Matrix<double>& layerOutput(const int& s, const int& slot, const int& k) {
+        auto& stage = *m_stages[s];
+        if(k < stage.outputs[slot].size()) {
+            return stage.outputs[slot][k];
+        }
+        return m_forward[s]->buffers[stage.sent[slot]];
+    }
+
+    void forward(const int& s, const int& id) {
+        auto& stage = *m_stages[s];
+        const int slot = id % (m_stages.size() - s);
+        if(s > 0) {
+            stage.received[slot] = m_forward[s-1]->ready.pop();
+        }
+        if(s + 1 < m_stages.size()) {
+            stage.sent[slot] = m_forward[s]->free.pop();
+        }
+
+        ConstMatrixView<double> input = stageInput(s, id);
+        for(int k=0; k<stage.weights.size(); ++k) {
+            auto& output = layerOutput(s, slot, k);
+            gemm<double>(stage.weights[k], input, output);
+            for(int j=0; j<output.getRows()*m_microBatch; ++j) {
+                output.data()[j] = expit(output.data()[j]);
+            }
+            input = output;
+        }
+        if(s + 1 < m_stages.size()) {
+            m_forward[s]->ready.push(stage.sent[slot]);
+        }
+    }
+
+    void backward(const int& s, const int& id) {
+        auto& stage = *m_stages[s];
+        const int slot = id % (m_stages.size() - s);
+        const int last = stage.weights.size() - 1;
+
+        // upstream is the error of the stage's last layer: target - output
+        // for the last stage, otherwise what the next stage sent back.
+        const Matrix<double>* upstream = &stage.error;
+        int received = -1;
+        if(s + 1 == m_stages.size()) {
+            const auto& output = layerOutput(s, slot, last);
+            auto& error = stage.error;
+            const auto target = m_target.block(0, id * m_microBatch, output.getRows(), m_microBatch);
+            double squared = 0;
+            for(int i=0; i<output.getRows(); ++i) {
+                for(int j=0; j<m_microBatch; ++j) {
+                    error[i][j] = target(i, j) - output[i][j];
+                    squared += error[i][j] * error[i][j];
+                }
+            }
+            m_squaredError += squared;
+        } else {
+            received = m_backward[s]->ready.pop();
+            upstream = &m_backward[s]->buffers[received];
+        }
+
+        // The first layer's error goes straight into a buffer of the link
+        // to the previous stage.
+        int sent = -1;
+        if(s > 0) {
+            sent = m_backward[s-1]->free.pop();
+        }
+        for(int k=last; k>=0; --k) {
+            const auto& output = layerOutput(s, slot, k);
+            auto& delta = stage.deltas[k];
+            for(int j=0; j<output.getRows()*m_microBatch; ++j) {
+                const double out = output.data()[j];
+                delta.data()[j] = upstream->data()[j] * out * (1.0 - out);
+            }
+
+            const ConstMatrixView<double> input = (k > 0)? ConstMatrixView<double>(layerOutput(s, slot, k-1)): stageInput(s, id);
+            gemm<double>(delta, input.transpose(), stage.gradients[k], 1.0, true);
+            if(k > 0) {
+                gemm<double>(ConstMatrixView<double>(stage.weights[k]).transpose(), delta, stage.errors[k]);
+                upstream = &stage.errors[k];
+            } else if(s > 0) {
+                gemm<double>(ConstMatrixView<double>(stage.weights[k]).transpose(), delta, m_backward[s-1]->buffers[sent]);
+            }
+        }
+        if(received != -1) {
+            m_backward[s]->free.push(received);
+            m_forward[s]->free.push(stage.sent[slot]);
+        }
+        if(s > 0) {
+            m_backward[s-1]->ready.push(sent);
+        }
+    }
+private:
+    double m_learningRate;
+    int m_microBatch;
+    std::vector<std::unique_ptr<Stage>> m_stages;
+    std::vector<std::unique_ptr<Link>> m_forward;
+    std::vector<std::unique_ptr<Link>> m_backward;
+
+    ConstMatrixView<double> m_input{nullptr, 0, 0, 0};
+    ConstMatrixView<double> m_target{nullptr, 0, 0, 0};
+    int m_microBatches = 0;
+    double m_squaredError = 0;
+    double m_error = 0;
+
+    long m_generation = 0;
+    int m_running = 0;
+    bool m_stop = false;
+    std::mutex m_mutex;
+    std::condition_variable m_start;
+    std::condition_variable m_finished;
+    std::vector<std::thread> m_threads;
+};
+
+#endif
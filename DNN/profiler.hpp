@@ -0,0 +1,245 @@
+#ifndef PROFILER_HPP
+#define PROFILER_HPP
+
+#include <atomic>
+#include <chrono>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <iostream>
+#include <iomanip>
+#include <cstring>
+#include <cstdint>
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+// Opt-in per kernel profiling. Building with -DDNN_PROFILE turns every
+// PROFILE_SCOPE into a measured region; otherwise the macro is empty and
+// costs nothing. Each thread opens its own perf_event counter group
+// (cycles, instructions, L1D read misses, LLC misses, branch misses) the
+// first time it enters a region. If the kernel refuses perf events the
+// regions are still timed. A summary is printed when the process exits.
+//
+// Regions are inclusive: a kernel called inside another region counts
+// towards both. Work a kernel hands to scheduler workers is counted by
+// the region those workers enter, not by the caller's.
+
+struct ProfileCounter {
+    enum { cycles, instructions, l1Misses, llcMisses, branchMisses, count };
+};
+
+struct ProfileSite {
+    ProfileSite(const std::string& name)
+    :   name(name) {}
+
+    std::string name;
+    std::atomic<std::uint64_t> calls{0};
+    std::atomic<std::uint64_t> nanoseconds{0};
+    std::atomic<std::uint64_t> counters[ProfileCounter::count] = {};
+};
+
+// One perf_event group per thread. Counters the PMU does not offer are
+// left out of the group and reported as missing.
+class CounterGroup {
+public:
+    CounterGroup() {
+        const std::pair<std::uint32_t, std::uint64_t> events[ProfileCounter::count] = {
+            { PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES },
+            { PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS },
+            { PERF_TYPE_HW_CACHE, PERF_COUNT_HW_CACHE_L1D | (PERF_COUNT_HW_CACHE_OP_READ << 8) | (PERF_COUNT_HW_CACHE_RESULT_MISS << 16) },
+            { PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_MISSES },
+            { PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_MISSES }
+        };
+
+        for(int i=0; i<ProfileCounter::count; ++i) {
+            perf_event_attr attr;
+            std::memset(&attr, 0, sizeof(attr));
+            attr.size = sizeof(attr);
+            attr.type = events[i].first;
+            attr.config = events[i].second;
+            attr.disabled = (m_leader == -1);
+            attr.exclude_kernel = 1;
+            attr.exclude_hv = 1;
+            attr.read_format = PERF_FORMAT_GROUP;
+
+            int fd = ::syscall(SYS_perf_event_open, &attr, 0, -1, m_leader, 0);
+            if(fd == -1) {
+                if(i == ProfileCounter::cycles) {
+                    return;
+                }
+                continue;
+            }
+            if(m_leader == -1) {
+                m_leader = fd;
+            }
+            m_fds.push_back(fd);
+            m_index[i] = m_members++;
+        }
+        ::ioctl(m_leader, PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP);
+    }
+
+    // Bit i is set when counter i could be opened.
+    int getCounters() const {
+        int counters = 0;
+        for(int i=0; i<ProfileCounter::count; ++i) {
+            counters |= (m_index[i] != -1) << i;
+        }
+        return counters;
+    }
+
+    CounterGroup(const CounterGroup&) = delete;
+    CounterGroup& operator=(const CounterGroup&) = delete;
+
+    ~CounterGroup() {
+        for(auto fd: m_fds) {
+            ::close(fd);
+        }
+    }
+
+    // values[counter] for every counter in the group.
+    void read(std::uint64_t (&values)[ProfileCounter::count]) const {
+        std::uint64_t buffer[1 + ProfileCounter::count] = {};
+        if(m_leader == -1 || ::read(m_leader, buffer, sizeof(buffer)) <= 0) {
+            return;
+        }
+        for(int i=0; i<ProfileCounter::count; ++i) {
+            values[i] = (m_index[i] == -1)? 0: buffer[1 + m_index[i]];
+        }
+    }
+private:
+    int m_leader = -1;
+    int m_members = 0;
+    int m_index[ProfileCounter::count] = { -1, -1, -1, -1, -1 };
+    std::deque<int> m_fds;
+};
+
+class Profiler {
+private:
+    Profiler() {}
+public:
+    Profiler(const Profiler&) = delete;
+    Profiler& operator=(const Profiler&) = delete;
+
+    ~Profiler() {
+        report(std::cerr);
+    }
+
+    static Profiler& instance() {
+        static Profiler profiler;
+        return profiler;
+    }
+
+    ProfileSite& site(const std::string& name) {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        for(auto& site: m_sites) {
+            if(site.name == name) {
+                return site;
+            }
+        }
+        m_sites.emplace_back(name);
+        return m_sites.back();
+    }
+
+    // This thread's counter group, opened on first use.
+    CounterGroup& localGroup() {
+        thread_local CounterGroup group;
+        thread_local bool registered = false;
+        if(!registered) {
+            m_counters.fetch_or(group.getCounters());
+            registered = true;
+        }
+        return group;
+    }
+
+    void report(std::ostream& out) {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if(m_sites.empty()) {
+            return;
+        }
+
+        const int counters = m_counters.load();
+        const bool available = counters & (1 << ProfileCounter::cycles);
+        out << "\nprofile (" << (available? "perf counters": "perf events unavailable, timers only") << ")\n";
+        out << std::left << std::setw(16) << "kernel" << std::right << std::setw(10) << "calls" << std::setw(12) << "ms";
+        if(available) {
+            out << std::setw(8) << "IPC" << std::setw(14) << "L1 miss/ki" << std::setw(14) << "LLC miss/ki" << std::setw(14) << "br miss/ki";
+        }
+        out << '\n';
+
+        out << std::fixed;
+        for(const auto& site: m_sites) {
+            const double calls = site.calls.load();
+            if(calls == 0) {
+                continue;
+            }
+            out << std::left << std::setw(16) << site.name << std::right << std::setw(10) << std::setprecision(0) << calls
+                << std::setw(12) << std::setprecision(2) << site.nanoseconds.load() * 1e-6;
+            if(available) {
+                const double instructions = std::max<std::uint64_t>(site.counters[ProfileCounter::instructions].load(), 1);
+                auto perKilo = [&](const int& counter) {
+                    out << std::setw(14);
+                    if(counters & (1 << counter)) {
+                        out << 1000.0 * site.counters[counter].load() / instructions;
+                    } else {
+                        out << "-";
+                    }
+                };
+                out << std::setw(8) << instructions / std::max<std::uint64_t>(site.counters[ProfileCounter::cycles].load(), 1);
+                perKilo(ProfileCounter::l1Misses);
+                perKilo(ProfileCounter::llcMisses);
+                perKilo(ProfileCounter::branchMisses);
+            }
+            out << '\n';
+        }
+        out << std::defaultfloat;
+    }
+private:
+    std::mutex m_mutex;
+    std::deque<ProfileSite> m_sites;
+    std::atomic<int> m_counters{0};
+};
+
+class ProfileScope {
+public:
+    ProfileScope(ProfileSite& site)
+    :   m_site(site),
+        m_group(Profiler::instance().localGroup()) {
+        m_group.read(m_begin);
+        m_start = std::chrono::steady_clock::now();
+    }
+
+    ProfileScope(const ProfileScope&) = delete;
+    ProfileScope& operator=(const ProfileScope&) = delete;
+
+    ~ProfileScope() {
+        const auto elapsed = std::chrono::steady_clock::now() - m_start;
+        std::uint64_t end[ProfileCounter::count] = {};
+        m_group.read(end);
+
+        m_site.calls.fetch_add(1, std::memory_order_relaxed);
+        m_site.nanoseconds.fetch_add(std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count(), std::memory_order_relaxed);
+        for(int i=0; i<ProfileCounter::count; ++i) {
+            m_site.counters[i].fetch_add(end[i] - m_begin[i], std::memory_order_relaxed);
+        }
+    }
+private:
+    ProfileSite& m_site;
+    CounterGroup& m_group;
+    std::uint64_t m_begin[ProfileCounter::count] = {};
+    std::chrono::steady_clock::time_point m_start;
+};
+
+#define PROFILE_CONCAT_(a, b) a##b
+#define PROFILE_CONCAT(a, b) PROFILE_CONCAT_(a, b)
+
+#ifdef DNN_PROFILE
+#define PROFILE_SCOPE(name) \
+    static ProfileSite& PROFILE_CONCAT(profileSite, __LINE__) = Profiler::instance().site(name); \
+    ProfileScope PROFILE_CONCAT(profileScope, __LINE__)(PROFILE_CONCAT(profileSite, __LINE__))
+#else
+#define PROFILE_SCOPE(name)
+#endif
+
+#endif
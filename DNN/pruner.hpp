@@ -0,0 +1,91 @@
+#ifndef PRUNER_HPP
+#define PRUNER_HPP
+
+#include "dnnModel.hpp"
+#include <vector>
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+
+// Magnitude pruning. Each layer keeps a mask of the connections that were
+// removed so they can be zeroed again after fine-tuning has moved them.
+class Pruner {
+private:
+    Pruner(const double& threshold, const double& sparsity)
+    :   m_threshold(threshold),
+        m_sparsity(sparsity) {}
+public:
+    static Pruner threshold(const double& threshold) {
+        return Pruner(threshold, -1);
+    }
+
+    static Pruner sparsity(const double& sparsity) {
+        if(sparsity < 0 || sparsity >= 1) {
+            throw std::invalid_argument("sparsity must be in the range [0, 1)");
+        }
+        return Pruner(-1, sparsity);
+    }
+
+    void prune(DnnModel& model) {
+        m_masks.clear();
+        for(auto& weight: model.m_weights) {
+            auto threshold = (m_sparsity < 0)? m_threshold: layerThreshold(weight);
+            std::vector<bool> mask(weight.getRows() * weight.getCols());
+            for(int i=0; i<weight.getRows(); ++i) {
+                for(int j=0; j<weight.getCols(); ++j) {
+                    mask[i*weight.getCols() + j] = std::abs(weight[i][j]) < threshold;
+                }
+            }
+            m_masks.push_back(std::move(mask));
+        }
+        reapply(model);
+    }
+
+    void reapply(DnnModel& model) const {
+        if(m_masks.size() != model.m_weights.size()) {
+            throw std::length_error("model does not match the pruned topology");
+        }
+        for(int l=0; l<model.m_weights.size(); ++l) {
+            auto& weight = model.m_weights[l];
+            for(int i=0; i<weight.getRows(); ++i) {
+                for(int j=0; j<weight.getCols(); ++j) {
+                    if(m_masks[l][i*weight.getCols() + j]) {
+                        weight[i][j] = 0;
+                    }
+                }
+            }
+        }
+    }
+
+    static double getSparsity(const DnnModel& model) {
+        long zeros = 0, total = 0;
+        for(const auto& weight: model.m_weights) {
+            for(int i=0; i<weight.getRows(); ++i) {
+                for(int j=0; j<weight.getCols(); ++j) {
+                    zeros += (weight[i][j] == 0);
+                }
+            }
+            total += weight.getRows() * weight.getCols();
+        }
+        return zeros / double(total);
+    }
+private:
+    double layerThreshold(const Matrix<double>& weight) const {
+        std::vector<double> magnitudes(weight.getRows() * weight.getCols());
+        for(int i=0; i<magnitudes.size(); ++i) {
+            magnitudes[i] = std::abs(weight.data()[i]);
+        }
+        auto nth = magnitudes.begin() + std::size_t(m_sparsity * magnitudes.size());
+        if(nth == magnitudes.end()) {
+            return 0;
+        }
+        std::nth_element(magnitudes.begin(), nth, magnitudes.end());
+        return *nth;
+    }
+private:
+    double m_threshold;
+    double m_sparsity;
+    std::vector<std::vector<bool>> m_masks;
+};
+
+#endif
@@ -0,0 +1,306 @@
+#ifndef RECOMPUTING_TRAINER_HPP
+#define RECOMPUTING_TRAINER_HPP
+
+#include "kernels.hpp"
+#include "matrixView.hpp"
+#include "activation.hpp"
+#include "dnnModel.hpp"
+#include "memoryPlan.hpp"
+#include <vector>
+#include <string>
+#include <iostream>
+#include <cmath>
+#include <stdexcept>
+
+// Trains a dense sigmoid network within a fixed activation memory budget.
+// Only the outputs of checkpoint layers (and the last layer) are kept from
+// the forward pass; backward walks the segments between checkpoints from
+// the last one, recomputing each segment's inner outputs from the
+// checkpoint before it just before they are needed. A batch is processed
+// as micro-batches whose gradients are summed, and the weights are updated
+// once per batch, so the effective batch size does not cost memory.
+//
+// Checkpoints are chosen when the trainer is built: every set of layers
+// (or evenly spaced sets for deep networks) is laid out with MemoryPlan,
+// and the one that fits the budget with the least recomputation wins.
+class RecomputingTrainer {
+public:
+    RecomputingTrainer(const DnnModel& model, const int& microBatch, const std::size_t& budget)
+    :   m_learningRate(model.m_learningRate),
+        m_microBatch(microBatch),
+        m_weights(model.m_weights) {
+
+        const int L = m_weights.size();
+        if(L == 0) {
+            throw std::length_error("Network needs atleast two layers.");
+        }
+        if(microBatch < 1) {
+            throw std::invalid_argument("micro-batches need atleast one sample");
+        }
+        for(int i=0; i<L; ++i) {
+            if(i > 0 && m_weights[i].getCols() != m_weights[i-1].getRows()) {
+                throw std::length_error("mismatched layer sizes in model");
+            }
+            m_gradients.emplace_back(m_weights[i].getRows(), m_weights[i].getCols());
+        }
+
+        std::vector<std::vector<bool>> candidates;
+        if(L - 1 <= 12) {
+            for(long mask=0; mask < (1L << (L-1)); ++mask) {
+                std::vector<bool> stored(L, true);
+                for(int j=0; j<L-1; ++j) {
+                    stored[j] = mask & (1L << j);
+                }
+                candidates.push_back(stored);
+            }
+        } else {
+            for(int spacing=1; spacing<=L; ++spacing) {
+                std::vector<bool> stored(L, false);
+                for(int j=spacing-1; j<L; j+=spacing) {
+                    stored[j] = true;
+                }
+                stored[L-1] = true;
+                candidates.push_back(stored);
+            }
+        }
+
+        bool found = false;
+        std::size_t smallest = -1;
+        for(const auto& stored: candidates) {
+            auto schedule = makeSchedule(stored);
+            const auto bytes = schedule.plan.getPeak() * sizeof(double);
+            smallest = std::min(smallest, bytes);
+            if(bytes > budget) {
+                continue;
+            }
+            if(!found || schedule.recomputeFlops < m_schedule.recomputeFlops ||
+               (schedule.recomputeFlops == m_schedule.recomputeFlops && schedule.plan.getPeak() < m_schedule.plan.getPeak())) {
+                m_schedule = std::move(schedule);
+                found = true;
+            }
+        }
+        if(!found) {
+            throw std::length_error("memory budget of " + std::to_string(budget) + " bytes is below the " +
+                                    std::to_string(smallest) + " bytes one micro-batch needs");
+        }
+        m_arena.resize(m_schedule.plan.getPeak());
+        m_keepAll = makeSchedule(std::vector<bool>(L, true)).plan.getPeak() * sizeof(double);
+    }
+
+    // Inputs are (inputs x batch) and targets (outputs x batch); batch must
+    // be a multiple of the micro-batch size.
+    void train(const ConstMatrixView<double>& input, const ConstMatrixView<double>& target) {
+        if(input.getRows() != m_weights.front().getCols() || target.getRows() != m_weights.back().getRows() ||
+           input.getCols() != target.getCols() || input.getCols() % m_microBatch != 0) {
+            throw std::length_error("batch does not match the network or the micro-batch size");
+        }
+
+        double squared = 0;
+        for(int first=0; first<input.getCols(); first+=m_microBatch) {
+            squared += step(input.block(0, first, input.getRows(), m_microBatch), target.block(0, first, target.getRows(), m_microBatch));
+        }
+        m_error = std::sqrt(squared / (double(target.getRows()) * input.getCols()));
+
+        for(int i=0; i<m_weights.size(); ++i) {
+            m_weights[i] += m_learningRate * m_gradients[i];
+            std::fill(m_gradients[i].data(), m_gradients[i].data() + m_gradients[i].getRows()*m_gradients[i].getCols(), 0.0);
+        }
+    }
+
+    double getError() const {
+        return m_error;
+    }
+
+    // Layers whose outputs are kept from the forward pass.
+    std::vector<int> getCheckpoints() const {
+        std::vector<int> checkpoints;
+        for(int j=0; j<m_weights.size(); ++j) {
+            if(m_schedule.stored[j]) {
+                checkpoints.push_back(j);
+            }
+        }
+        return checkpoints;
+    }
+
+    // Activation and error memory for one micro-batch.
+    std::size_t getPeakBytes() const {
+        return m_arena.size() * sizeof(double);
+    }
+
+    // What the same micro-batch needs when every output is kept.
+    const std::size_t& getKeepAllBytes() const {
+        return m_keepAll;
+    }
+
+    std::size_t getGradientBytes() const {
+        std::size_t bytes = 0;
+        for(const auto& gradient: m_gradients) {
+            bytes += gradient.getRows() * gradient.getCols() * sizeof(double);
+        }
+        return bytes;
+    }
+
+    // Extra forward work per micro-batch, relative to one forward pass.
+    double getRecomputeRatio() const {
+        long flops = 0;
+        for(const auto& weight: m_weights) {
+            flops += 2L * weight.getRows() * weight.getCols() * m_microBatch;
+        }
+        return double(m_schedule.recomputeFlops) / flops;
+    }
+
+    const MemoryPlan& getPlan() const {
+        return m_schedule.plan;
+    }
+
+    DnnModel getModel() const {
+        return DnnModel{m_learningRate, m_weights};
+    }
+private:
+    struct Schedule {
+        std::vector<bool> stored;
+        std::vector<int> segment;
+        std::vector<int> forward;
+        std::vector<int> recomputed;
+        std::vector<int> delta;
+        long recomputeFlops = 0;
+        MemoryPlan plan;
+    };
+
+    // Steps: forward of layer j is step j. Backward then runs segment by
+    // segment from the last: the recompute of each inner layer is a step,
+    // followed by one step per layer, top down, that adds its gradient and
+    // writes the error of the layer below.
+    Schedule makeSchedule(const std::vector<bool>& stored) const {
+        const int L = m_weights.size();
+        Schedule schedule;
+        schedule.stored = stored;
+        schedule.segment.resize(L);
+        schedule.forward.assign(L, -1);
+        schedule.recomputed.assign(L, -1);
+        schedule.delta.assign(L, -1);
+
+        std::vector<int> begins = { 0 };
+        for(int j=0; j<L; ++j) {
+            schedule.segment[j] = begins.size() - 1;
+            if(stored[j] && j+1 < L) {
+                begins.push_back(j+1);
+            }
+        }
+        const int last = begins.size() - 1;
+
+        std::vector<int> backStep(L), recomputeStep(L, -1);
+        int step = L;
+        for(int k=last; k>=0; --k) {
+            const int end = (k == last)? L-1: begins[k+1]-1;
+            if(k < last) {
+                for(int j=begins[k]; j<end; ++j) {
+                    recomputeStep[j] = step++;
+                    schedule.recomputeFlops += 2L * m_weights[j].getRows() * m_weights[j].getCols() * m_microBatch;
+                }
+            }
+            for(int j=end; j>=begins[k]; --j) {
+                backStep[j] = step++;
+            }
+        }
+
+        for(int j=0; j<L; ++j) {
+            const std::size_t size = m_weights[j].getRows() * m_microBatch;
+            const int lastRead = (j+1 < L)? backStep[j+1]: backStep[j];
+            const std::string name = std::to_string(j);
+            if(stored[j] || schedule.segment[j] == last) {
+                schedule.forward[j] = schedule.plan.add("output" + name, size, j, lastRead);
+            } else {
+                schedule.forward[j] = schedule.plan.add("output" + name, size, j, j+1);
+                schedule.recomputed[j] = schedule.plan.add("recompute" + name, size, recomputeStep[j], lastRead);
+            }
+            schedule.delta[j] = schedule.plan.add("error" + name, size, (j+1 < L)? backStep[j+1]: backStep[j], backStep[j]);
+        }
+        schedule.plan.plan();
+        return schedule;
+    }
+
+    double* buffer(const int& id) {
+        return m_arena.data() + m_schedule.plan.getOffset(id);
+    }
+
+    // Where layer j's output is during backward.
+    double* output(const int& j) {
+        const auto& s = m_schedule;
+        return buffer((s.recomputed[j] == -1)? s.forward[j]: s.recomputed[j]);
+    }
+
+    // out(rows x batch) = expit(weight * in).
+    void layer(const int& j, const ConstMatrixView<double>& input, const double* in, double* out) {
+        const auto& weight = m_weights[j];
+        if(j == 0) {
+            gemm<double>(weight, input, MatrixView<double>(out, weight.getRows(), m_microBatch, m_microBatch));
+        } else {
+            gemm(weight.getRows(), m_microBatch, weight.getCols(), weight.data(), in, out);
+        }
+        for(int i=0; i<weight.getRows()*m_microBatch; ++i) {
+            out[i] = expit(out[i]);
+        }
+    }
+
+    // One micro-batch: adds its gradients and returns its squared error.
+    double step(const ConstMatrixView<double>& input, const ConstMatrixView<double>& target) {
+        const auto& s = m_schedule;
+        const int L = m_weights.size();
+        for(int j=0; j<L; ++j) {
+            layer(j, input, j? buffer(s.forward[j-1]): nullptr, buffer(s.forward[j]));
+        }
+
+        const int outputs = m_weights.back().getRows();
+        const double* out = buffer(s.forward[L-1]);
+        double* delta = buffer(s.delta[L-1]);
+        double squared = 0;
+        for(int j=0; j<outputs*m_microBatch; ++j) {
+            const double error = target(j / m_microBatch, j % m_microBatch) - out[j];
+            squared += error * error;
+            delta[j] = error * out[j] * (1.0 - out[j]);
+        }
+
+        for(int j=L-1; j>=0; --j) {
+            // Entering a segment from the top: rebuild its inner outputs
+            // from the checkpoint below it.
+            if(j+1 == L || s.stored[j]) {
+                int begin = j;
+                while(begin > 0 && !s.stored[begin-1]) {
+                    --begin;
+                }
+                for(int r=begin; r<j; ++r) {
+                    if(s.recomputed[r] != -1) {
+                        layer(r, input, r? output(r-1): nullptr, buffer(s.recomputed[r]));
+                    }
+                }
+            }
+
+            const auto& weight = m_weights[j];
+            delta = buffer(s.delta[j]);
+            if(j > 0) {
+                const double* in = output(j-1);
+                double* previous = buffer(s.delta[j-1]);
+                gemmTransA(weight.getCols(), m_microBatch, weight.getRows(), weight.data(), delta, previous);
+                for(int i=0; i<weight.getCols()*m_microBatch; ++i) {
+                    previous[i] *= in[i] * (1.0 - in[i]);
+                }
+                gemmTransB(weight.getRows(), weight.getCols(), m_microBatch, 1.0, delta, in, m_gradients[j].data());
+            } else {
+                gemm<double>(ConstMatrixView<double>(delta, weight.getRows(), m_microBatch, m_microBatch), input.transpose(), m_gradients[j], 1.0, true);
+            }
+        }
+        return squared;
+    }
+private:
+    double m_learningRate;
+    double m_error = 0;
+    int m_microBatch;
+    std::vector<Matrix<double>> m_weights;
+    std::vector<Matrix<double>> m_gradients;
+    Schedule m_schedule;
+    std::vector<double> m_arena;
+    std::size_t m_keepAll;
+};
+
+#endif
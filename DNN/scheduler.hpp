@@ -0,0 +1,371 @@
+#ifndef SCHEDULER_HPP
+#define SCHEDULER_HPP
+
+#include <atomic>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+#include <exception>
+#include <vector>
+#include <deque>
+#include <memory>
+#include <random>
+#include <cstdlib>
+#include <pthread.h>
+#include <sched.h>
+
+class TaskGroup;
+
+struct Task {
+    std::function<void()> function;
+    TaskGroup* group;
+};
+
+// Chase-Lev work stealing deque with a fixed capacity. The owning worker
+// pushes and pops at the bottom, thieves take from the top.
+class WorkDeque {
+public:
+    WorkDeque(const long& capacity = 4096)
+    :   m_mask(capacity - 1),
+        m_tasks(capacity) {}
+
+    bool push(Task* task) {
+        auto b = m_bottom.load(std::memory_order_relaxed);
+        auto t = m_top.load(std::memory_order_acquire);
+        if(b - t > m_mask) {
+            return false;
+        }
+        m_tasks[b & m_mask].store(task, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+        m_bottom.store(b + 1, std::memory_order_relaxed);
+        return true;
+    }
+
+    Task* pop() {
+        auto b = m_bottom.load(std::memory_order_relaxed) - 1;
+        m_bottom.store(b, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        auto t = m_top.load(std::memory_order_relaxed);
+
+        if(t > b) {
+            m_bottom.store(b + 1, std::memory_order_relaxed);
+            return nullptr;
+        }
+
+        Task* task = m_tasks[b & m_mask].load(std::memory_order_relaxed);
+        if(t == b) {
+            if(!m_top.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed)) {
+                task = nullptr;
+            }
+            m_bottom.store(b + 1, std::memory_order_relaxed);
+        }
+        return task;
+    }
+
+    Task* steal() {
+        auto t = m_top.load(std::memory_order_acquire);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        auto b = m_bottom.load(std::memory_order_acquire);
+
+        if(t >= b) {
+            return nullptr;
+        }
+        Task* task = m_tasks[t & m_mask].load(std::memory_order_relaxed);
+        if(!m_top.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed)) {
+            return nullptr;
+        }
+        return task;
+    }
+private:
+    long m_mask;
+    std::vector<std::atomic<Task*>> m_tasks;
+    alignas(64) std::atomic<long> m_top{0};
+    alignas(64) std::atomic<long> m_bottom{0};
+};
+
+// One pool of workers for the whole process. Threads that are not workers
+// submit through a shared injection queue, and every thread waiting on a
+// TaskGroup runs queued tasks instead of blocking, so nested parallel
+// regions never deadlock or oversubscribe the cores.
+//
+// DNN_THREADS overrides the number of threads (including the caller) and
+// DNN_PIN=1 pins each worker to its own CPU.
+class Scheduler {
+private:
+    Scheduler() {
+        int threads = std::thread::hardware_concurrency();
+        if(auto env = std::getenv("DNN_THREADS")) {
+            threads = std::atoi(env);
+        }
+        const bool pin = std::getenv("DNN_PIN") && std::atoi(std::getenv("DNN_PIN"));
+
+        const int workers = std::max(threads, 1) - 1;
+        for(int i=0; i<workers; ++i) {
+            m_deques.push_back(std::make_unique<WorkDeque>());
+        }
+        for(int i=0; i<workers; ++i) {
+            m_workers.emplace_back(&Scheduler::run, this, i, pin);
+        }
+    }
+public:
+    Scheduler(const Scheduler&) = delete;
+    Scheduler& operator=(const Scheduler&) = delete;
+
+    ~Scheduler() {
+        m_stop = true;
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+        }
+        m_sleep.notify_all();
+        for(auto& worker: m_workers) {
+            worker.join();
+        }
+    }
+
+    static Scheduler& instance() {
+        static Scheduler scheduler;
+        return scheduler;
+    }
+
+    int getConcurrency() const {
+        return m_workers.size() + 1;
+    }
+
+    void submit(Task* task) {
+        auto worker = currentWorker();
+        if(worker >= 0) {
+            if(!m_deques[worker]->push(task)) {
+                execute(task);
+                return;
+            }
+        } else {
+            std::lock_guard<std::mutex> lock(m_injectionMutex);
+            m_injection.push_back(task);
+        }
+
+        m_pending.fetch_add(1);
+        if(m_sleeping.load() > 0) {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_sleep.notify_one();
+        }
+    }
+
+    bool runOne() {
+        auto task = take(currentWorker());
+        if(!task) {
+            return false;
+        }
+        execute(task);
+        return true;
+    }
+private:
+    static int& currentWorker() {
+        thread_local int worker = -1;
+        return worker;
+    }
+
+    Task* take(const int& worker) {
+        Task* task = nullptr;
+        if(worker >= 0) {
+            task = m_deques[worker]->pop();
+        }
+        if(!task && !m_deques.empty()) {
+            thread_local std::minstd_rand generator(std::hash<std::thread::id>()(std::this_thread::get_id()));
+            const int start = generator() % m_deques.size();
+            for(int i=0; i<m_deques.size() && !task; ++i) {
+                const int victim = (start + i) % m_deques.size();
+                if(victim != worker) {
+                    task = m_deques[victim]->steal();
+                }
+            }
+        }
+        if(!task) {
+            std::lock_guard<std::mutex> lock(m_injectionMutex);
+            if(!m_injection.empty()) {
+                task = m_injection.front();
+                m_injection.pop_front();
+            }
+        }
+        if(task) {
+            m_pending.fetch_sub(1);
+        }
+        return task;
+    }
+
+    void execute(Task* task);
+
+    void run(const int& index, const bool& pin) {
+        currentWorker() = index;
+
+        if(pin) {
+            cpu_set_t set;
+            CPU_ZERO(&set);
+            CPU_SET((index + 1) % std::thread::hardware_concurrency(), &set);
+            pthread_setaffinity_np(pthread_self(), sizeof(set), &set);
+        }
+
+        while(!m_stop) {
+            if(runOne()) {
+                continue;
+            }
+            bool found = false;
+            for(int spin=0; spin<64 && !found; ++spin) {
+                std::this_thread::yield();
+                found = m_pending.load() > 0;
+            }
+            if(found) {
+                continue;
+            }
+
+            std::unique_lock<std::mutex> lock(m_mutex);
+            m_sleeping.fetch_add(1);
+            m_sleep.wait(lock, [this] { return m_stop || m_pending.load() > 0; });
+            m_sleeping.fetch_sub(1);
+        }
+    }
+private:
+    std::vector<std::unique_ptr<WorkDeque>> m_deques;
+    std::vector<std::thread> m_workers;
+    std::deque<Task*> m_injection;
+    std::mutex m_injectionMutex;
+    std::mutex m_mutex;
+    std::condition_variable m_sleep;
+    std::atomic<int> m_pending{0};
+    std::atomic<int> m_sleeping{0};
+    std::atomic<bool> m_stop{false};
+};
+
+class TaskGroup {
+public:
+    TaskGroup() {}
+    TaskGroup(const TaskGroup&) = delete;
+    TaskGroup& operator=(const TaskGroup&) = delete;
+
+    ~TaskGroup() {
+        if(m_count.load() > 0) {
+            help();
+        }
+    }
+
+    void run(std::function<void()> function) {
+        m_count.fetch_add(1);
+        Scheduler::instance().submit(new Task{ std::move(function), this });
+    }
+
+    void wait() {
+        help();
+        if(m_exception) {
+            auto exception = m_exception;
+            m_exception = nullptr;
+            std::rethrow_exception(exception);
+        }
+    }
+private:
+    friend class Scheduler;
+
+    void help() {
+        auto& scheduler = Scheduler::instance();
+        while(m_count.load(std::memory_order_acquire) > 0) {
+            if(!scheduler.runOne()) {
+                std::this_thread::yield();
+            }
+        }
+    }
+
+    void finish(std::exception_ptr exception) {
+        if(exception) {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            if(!m_exception) {
+                m_exception = exception;
+            }
+        }
+        m_count.fetch_sub(1, std::memory_order_release);
+    }
+private:
+    std::atomic<int> m_count{0};
+    std::mutex m_mutex;
+    std::exception_ptr m_exception;
+};
+
+inline void Scheduler::execute(Task* task) {
+    std::exception_ptr exception;
+    try {
+        task->function();
+    } catch(...) {
+        exception = std::current_exception();
+    }
+    auto group = task->group;
+    delete task;
+    group->finish(exception);
+}
+
+// While one is alive, parallel_for on this thread runs every chunk itself
+// and never touches the scheduler: no injection lock, no waiting behind
+// other threads' tasks. For threads that must never block, like the
+// readers of an OnlineLearner.
+class SerialRegion {
+public:
+    SerialRegion(const bool& enable = true)
+    :   m_previous(active()) {
+        active() = m_previous || enable;
+    }
+
+    SerialRegion(const SerialRegion&) = delete;
+    SerialRegion& operator=(const SerialRegion&) = delete;
+
+    ~SerialRegion() {
+        active() = m_previous;
+    }
+
+    static bool& active() {
+        thread_local bool serial = false;
+        return serial;
+    }
+private:
+    bool m_previous;
+};
+
+// Calls function(first, last) on chunks of at most grain indices.
+template<typename F>
+void parallel_for(const int& begin, const int& end, const int& grain, F&& function) {
+    const int size = end - begin;
+    if(size <= grain || SerialRegion::active() || Scheduler::instance().getConcurrency() == 1) {
+        if(size > 0) {
+            function(begin, end);
+        }
+        return;
+    }
+
+    TaskGroup group;
+    for(int first=begin + grain; first<end; first+=grain) {
+        const int last = std::min(first + grain, end);
+        group.run([&function, first, last] { function(first, last); });
+    }
+    function(begin, begin + grain);
+    group.wait();
+}
+
+// Reduces map(first, last) over chunks of at most grain indices.
+template<typename T, typename Map, typename Combine>
+T parallel_reduce(const int& begin, const int& end, const int& grain, const T& identity, Map&& map, Combine&& combine) {
+    const int size = end - begin;
+    if(size <= 0) {
+        return identity;
+    }
+    const int chunks = (size + grain - 1) / grain;
+    std::vector<T> partial(chunks, identity);
+    parallel_for(0, chunks, 1, [&](const int& first, const int& last) {
+        for(int c=first; c<last; ++c) {
+            partial[c] = map(begin + c*grain, std::min(begin + (c+1)*grain, end));
+        }
+    });
+
+    T result = identity;
+    for(const auto& value: partial) {
+        result = combine(result, value);
+    }
+    return result;
+}
+
+#endif
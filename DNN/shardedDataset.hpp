@@ -0,0 +1,190 @@
+#ifndef SHARDED_DATASET_HPP
+#define SHARDED_DATASET_HPP
+
+#include "mnist.hpp"
+#include <vector>
+#include <string>
+#include <random>
+#include <chrono>
+#include <algorithm>
+#include <filesystem>
+#include <stdexcept>
+#include <fcntl.h>
+#include <unistd.h>
+
+// Streams MNIST style CSV records ("label,p0,p1,...") from many shard
+// files. Memory stays at one read buffer plus the shuffle window no matter
+// how large the dataset is: shards are read sequentially in big chunks
+// and pages already consumed are dropped from the page cache.
+class ShardedDataset {
+public:
+    ShardedDataset(const std::vector<std::string>& shards, const int& shuffleWindow = 4096, const std::size_t& bufferSize = 1 << 22)
+    :   m_shards(shards),
+        m_buffer(bufferSize),
+        m_window(shuffleWindow),
+        m_generator(std::chrono::system_clock::now().time_since_epoch().count()) {
+
+        if(m_shards.empty()) {
+            throw std::invalid_argument("dataset needs atleast one shard");
+        }
+        if(shuffleWindow < 1) {
+            throw std::invalid_argument("shuffle window must hold atleast one sample");
+        }
+        reset();
+    }
+
+    ShardedDataset(const ShardedDataset&) = delete;
+    ShardedDataset& operator=(const ShardedDataset&) = delete;
+
+    ~ShardedDataset() {
+        close();
+    }
+
+    static ShardedDataset fromDirectory(const std::string& directory, const int& shuffleWindow = 4096) {
+        std::vector<std::string> shards;
+        for(const auto& entry: std::filesystem::directory_iterator(directory)) {
+            if(entry.is_regular_file() && entry.path().extension() == ".csv") {
+                shards.push_back(entry.path().string());
+            }
+        }
+        std::sort(shards.begin(), shards.end());
+        return ShardedDataset(shards, shuffleWindow);
+    }
+
+    void reset() {
+        close();
+        std::shuffle(m_shards.begin(), m_shards.end(), m_generator);
+        m_shard = 0;
+        m_count = 0;
+        m_bytesRead = 0;
+        open();
+    }
+
+    bool getNextData(MnistData& data) {
+        while(m_count < m_window.size() && parseNext(m_window[m_count])) {
+            ++m_count;
+        }
+        if(m_count == 0) {
+            return false;
+        }
+
+        std::uniform_int_distribution<std::size_t> pick(0, m_count-1);
+        auto k = pick(m_generator);
+        std::swap(data, m_window[k]);
+        std::swap(m_window[k], m_window[m_count-1]);
+        --m_count;
+        return true;
+    }
+
+    long long getBytesRead() const {
+        return m_bytesRead;
+    }
+private:
+    void open() {
+        m_begin = m_end = 0;
+        m_offset = 0;
+        m_fd = ::open(m_shards[m_shard].c_str(), O_RDONLY);
+        if(m_fd == -1) {
+            throw std::invalid_argument(m_shards[m_shard] + " not available");
+        }
+        ::posix_fadvise(m_fd, 0, 0, POSIX_FADV_SEQUENTIAL);
+    }
+
+    void close() {
+        if(m_fd != -1) {
+            ::posix_fadvise(m_fd, 0, 0, POSIX_FADV_DONTNEED);
+            ::close(m_fd);
+            m_fd = -1;
+        }
+    }
+
+    bool refill() {
+        std::copy(m_buffer.begin() + m_begin, m_buffer.begin() + m_end, m_buffer.begin());
+        m_end -= m_begin;
+        m_begin = 0;
+        if(m_end == m_buffer.size()) {
+            throw std::length_error("record longer than the read buffer");
+        }
+
+        auto count = ::read(m_fd, m_buffer.data() + m_end, m_buffer.size() - m_end);
+        if(count < 0) {
+            throw std::runtime_error(m_shards[m_shard] + ": read failed");
+        }
+        if(count > 0) {
+            ::posix_fadvise(m_fd, 0, m_offset, POSIX_FADV_DONTNEED);
+            m_offset += count;
+            m_bytesRead += count;
+            m_end += count;
+        }
+        return count > 0;
+    }
+
+    bool nextLine(const char*& first, const char*& last) {
+        for(;;) {
+            auto begin = m_buffer.data() + m_begin;
+            auto end = m_buffer.data() + m_end;
+            auto newline = std::find(begin, end, '\n');
+            if(newline != end) {
+                first = begin;
+                last = newline;
+                m_begin = newline + 1 - m_buffer.data();
+                return true;
+            }
+            if(!refill()) {
+                if(m_begin != m_end) {
+                    first = m_buffer.data() + m_begin;
+                    last = m_buffer.data() + m_end;
+                    m_begin = m_end;
+                    return true;
+                }
+                if(m_shard + 1 == m_shards.size()) {
+                    return false;
+                }
+                close();
+                ++m_shard;
+                open();
+            }
+        }
+    }
+
+    bool parseNext(MnistData& data) {
+        const char* first;
+        const char* last;
+        do {
+            if(!nextLine(first, last)) {
+                return false;
+            }
+        } while(first == last || *first == '\r');
+
+        data.pixels.clear();
+        int field = 0;
+        bool label = true;
+        for(auto c = first; c <= last; ++c) {
+            if(c != last && *c >= '0' && *c <= '9') {
+                field = field*10 + (*c - '0');
+            } else if(c == last || *c == ',') {
+                if(label) {
+                    data.label = field;
+                    label = false;
+                } else {
+                    data.pixels.push_back((field/255.0 * 0.99) + 0.01);
+                }
+                field = 0;
+            }
+        }
+        return true;
+    }
+private:
+    std::vector<std::string> m_shards;
+    std::vector<char> m_buffer;
+    std::vector<MnistData> m_window;
+    std::default_random_engine m_generator;
+    std::size_t m_begin = 0, m_end = 0;
+    std::size_t m_count = 0;
+    std::size_t m_shard = 0;
+    off_t m_offset = 0;
+    long long m_bytesRead = 0;
+    int m_fd = -1;
+};
+
+#endif
@@ -0,0 +1,31 @@
+#ifndef SPARSE_DNN_HPP
+#define SPARSE_DNN_HPP
+
+#include "sparseMatrix.hpp"
+#include "sparseDnnModel.hpp"
+#include "activation.hpp"
+#include <vector>
+
+class SparseDNN {
+public:
+    SparseDNN(const SparseDnnModel& model)
+    :   m_weights(model.m_weights),
+        m_outputs(model.m_weights.size()) {}
+
+    const Matrix<double>& query(const Vertex<double>& input_list) {
+        auto input = m_weights[0].dot(input_list);
+        m_outputs[0] = activate(input);
+
+        for(int i=1; i<m_weights.size(); ++i) {
+            input = m_weights[i].dot(m_outputs[i-1]);
+            m_outputs[i] = activate(input);
+        }
+
+        return m_outputs.back();
+    }
+private:
+    std::vector<SparseMatrix<double>> m_weights;
+    std::vector<Matrix<double>> m_outputs;
+};
+
+#endif
@@ -0,0 +1,114 @@
+#ifndef SPARSE_DNN_MODEL_HPP
+#define SPARSE_DNN_MODEL_HPP
+
+#include "sparseMatrix.hpp"
+#include "dnnModel.hpp"
+#include <vector>
+#include <fstream>
+#include <stdexcept>
+
+struct SparseDnnModel {
+
+    SparseDnnModel() {}
+
+    SparseDnnModel(const DnnModel& model)
+    :   m_learningRate(model.m_learningRate) {
+        for(const auto& weight: model.m_weights) {
+            m_weights.emplace_back(weight);
+        }
+    }
+
+    DnnModel toDense() const {
+        DnnModel model{m_learningRate, {}};
+        for(const auto& weight: m_weights) {
+            model.m_weights.push_back(weight.toDense());
+        }
+        return model;
+    }
+
+    void saveModel(const std::string& fileName) const {
+        auto index = fileName.find_last_of('.');
+        auto extension = fileName.substr(index+1);
+        if(extension == "rsm") {
+            saveRawModel(fileName);
+        } else {
+            throw std::invalid_argument(extension + ": no file format for extension");
+        }
+    }
+
+    static auto loadModel(const std::string& fileName) {
+        auto index = fileName.find_last_of('.');
+        auto extension = fileName.substr(index+1);
+        if(extension == "rsm") {
+            return loadRawModel(fileName);
+        } else {
+            throw std::invalid_argument(extension + ": no file format for extension");
+        }
+    }
+
+private:
+    void saveRawModel(const std::string& fileName) const {
+        std::ofstream file(fileName, std::ios::binary);
+        file.exceptions(std::ios::failbit | std::ios::badbit);
+
+        file.write((char*)&m_learningRate, sizeof(m_learningRate));
+        int size = m_weights.size();
+        file.write((char*)&size, sizeof(size));
+
+        for(const auto& weight: m_weights) {
+            int nonZeros = weight.getNonZeros();
+            file.write((char*)&weight.getRows(), sizeof(weight.getRows()));
+            file.write((char*)&weight.getCols(), sizeof(weight.getCols()));
+            file.write((char*)&nonZeros, sizeof(nonZeros));
+            file.write((char*)weight.getRowPtr().data(), sizeof(int) * (weight.getRows()+1));
+            file.write((char*)weight.getColIndex().data(), sizeof(int) * nonZeros);
+            file.write((char*)weight.getValues().data(), sizeof(double) * nonZeros);
+        }
+    }
+
+    static SparseDnnModel loadRawModel(const std::string& fileName) {
+        std::ifstream file(fileName, std::ios::binary);
+        file.exceptions(std::ios::failbit | std::ios::badbit);
+
+        SparseDnnModel model;
+        file.read((char*)&model.m_learningRate, sizeof(model.m_learningRate));
+        int weightCount;
+        file.read((char*)&weightCount, sizeof(weightCount));
+        int rows, cols, nonZeros;
+        for(int i=0; i<weightCount; ++i) {
+            file.read((char*)&rows, sizeof(rows));
+            file.read((char*)&cols, sizeof(cols));
+            file.read((char*)&nonZeros, sizeof(nonZeros));
+            if(rows < 1 || cols < 1 || nonZeros < 0 || long(nonZeros) > long(rows) * cols) {
+                throw std::length_error(fileName + ": corrupt sparse layer shape");
+            }
+            std::vector<int> rowPtr(rows+1);
+            std::vector<int> colIndex(nonZeros);
+            std::vector<double> values(nonZeros);
+            file.read((char*)rowPtr.data(), sizeof(int) * (rows+1));
+            file.read((char*)colIndex.data(), sizeof(int) * nonZeros);
+            file.read((char*)values.data(), sizeof(double) * nonZeros);
+            // dot() trusts these, so a corrupt file must not get past here.
+            if(rowPtr[0] != 0 || rowPtr[rows] != nonZeros) {
+                throw std::length_error(fileName + ": corrupt sparse row offsets");
+            }
+            for(int r=0; r<rows; ++r) {
+                if(rowPtr[r] > rowPtr[r+1]) {
+                    throw std::length_error(fileName + ": corrupt sparse row offsets");
+                }
+            }
+            for(const auto& col: colIndex) {
+                if(col < 0 || col >= cols) {
+                    throw std::length_error(fileName + ": sparse column index out of range");
+                }
+            }
+            model.m_weights.emplace_back(rows, cols, std::move(rowPtr), std::move(colIndex), std::move(values));
+        }
+        return model;
+    }
+public:
+    double m_learningRate;
+    std::vector<SparseMatrix<double>> m_weights;
+};
+
+#endif
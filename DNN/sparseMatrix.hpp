@@ -0,0 +1,118 @@
+#ifndef SPARSE_MATRIX_HPP
+#define SPARSE_MATRIX_HPP
+
+#include "matrix.hpp"
+#include <vector>
+#include <stdexcept>
+
+// Compressed sparse row storage. Only the non-zero weights of a pruned
+// matrix are kept, so dot() skips the zeroed connections entirely.
+template<typename T>
+class SparseMatrix {
+public:
+    SparseMatrix(const int& rows = 1, const int& cols = 1)
+    :   m_rows(rows),
+        m_cols(cols),
+        m_rowPtr(rows+1) {}
+
+    SparseMatrix(const Matrix<T>& matrix)
+    :   SparseMatrix(matrix.getRows(), matrix.getCols()) {
+
+        for(int i=0; i<m_rows; ++i) {
+            for(int j=0; j<m_cols; ++j) {
+                if(matrix[i][j] != T()) {
+                    m_colIndex.push_back(j);
+                    m_values.push_back(matrix[i][j]);
+                }
+            }
+            m_rowPtr[i+1] = m_values.size();
+        }
+    }
+
+    SparseMatrix(const int& rows, const int& cols, std::vector<int> rowPtr, std::vector<int> colIndex, std::vector<T> values)
+    :   m_rows(rows),
+        m_cols(cols),
+        m_rowPtr(std::move(rowPtr)),
+        m_colIndex(std::move(colIndex)),
+        m_values(std::move(values)) {
+
+        if(m_rowPtr.size() != m_rows+1 || m_colIndex.size() != m_values.size() || m_rowPtr.back() != m_values.size()) {
+            throw std::length_error("malformed compressed sparse row matrix");
+        }
+    }
+
+    const int& getRows() const {
+        return m_rows;
+    }
+
+    const int& getCols() const {
+        return m_cols;
+    }
+
+    int getNonZeros() const {
+        return m_values.size();
+    }
+
+    const std::vector<int>& getRowPtr() const {
+        return m_rowPtr;
+    }
+
+    const std::vector<int>& getColIndex() const {
+        return m_colIndex;
+    }
+
+    const std::vector<T>& getValues() const {
+        return m_values;
+    }
+
+    Matrix<T> toDense() const {
+        Matrix<T> mat(m_rows, m_cols);
+        for(int i=0; i<m_rows; ++i) {
+            for(int k=m_rowPtr[i]; k<m_rowPtr[i+1]; ++k) {
+                mat[i][m_colIndex[k]] = m_values[k];
+            }
+        }
+        return mat;
+    }
+
+    Matrix<T> dot(const Matrix<T>& other) const {
+        if(m_cols != other.getRows()) {
+            throw std::length_error("mismatched matrix for dot product. Dimensions not correct\n");
+        }
+
+        const int cols = other.getCols();
+        Matrix<T> mat(m_rows, cols);
+        const T* in = other.data();
+        T* out = mat.data();
+
+        if(cols == 1) {
+            for(int i=0; i<m_rows; ++i) {
+                T sum = T();
+                for(int k=m_rowPtr[i]; k<m_rowPtr[i+1]; ++k) {
+                    sum += m_values[k] * in[m_colIndex[k]];
+                }
+                out[i] = sum;
+            }
+            return mat;
+        }
+
+        for(int i=0; i<m_rows; ++i) {
+            T* row = out + i*cols;
+            for(int k=m_rowPtr[i]; k<m_rowPtr[i+1]; ++k) {
+                const T value = m_values[k];
+                const T* src = in + m_colIndex[k]*cols;
+                for(int j=0; j<cols; ++j) {
+                    row[j] += value * src[j];
+                }
+            }
+        }
+        return mat;
+    }
+private:
+    int m_rows, m_cols;
+    std::vector<int> m_rowPtr;
+    std::vector<int> m_colIndex;
+    std::vector<T> m_values;
+};
+
+#endif
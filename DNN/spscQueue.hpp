@@ -0,0 +1,68 @@
+#ifndef SPSC_QUEUE_HPP
+#define SPSC_QUEUE_HPP
+
+#include <atomic>
+#include <vector>
+#include <thread>
+#include <cstddef>
+
+// Bounded lock free queue for exactly one producer and one consumer
+// thread. Head and tail only ever grow and live on separate cache lines,
+// so each side writes one index and reads the other's. push() and pop()
+// yield while the queue is full or empty.
+template<typename T>
+class SpscQueue {
+public:
+    SpscQueue(const std::size_t& capacity) {
+        std::size_t size = 1;
+        while(size < capacity) {
+            size *= 2;
+        }
+        m_slots.resize(size);
+        m_mask = size - 1;
+    }
+
+    SpscQueue(const SpscQueue&) = delete;
+    SpscQueue& operator=(const SpscQueue&) = delete;
+
+    bool tryPush(T& value) {
+        const auto tail = m_tail.load(std::memory_order_relaxed);
+        if(tail - m_head.load(std::memory_order_acquire) == m_slots.size()) {
+            return false;
+        }
+        m_slots[tail & m_mask] = std::move(value);
+        m_tail.store(tail + 1, std::memory_order_release);
+        return true;
+    }
+
+    bool tryPop(T& value) {
+        const auto head = m_head.load(std::memory_order_relaxed);
+        if(head == m_tail.load(std::memory_order_acquire)) {
+            return false;
+        }
+        value = std::move(m_slots[head & m_mask]);
+        m_head.store(head + 1, std::memory_order_release);
+        return true;
+    }
+
+    void push(T value) {
+        while(!tryPush(value)) {
+            std::this_thread::yield();
+        }
+    }
+
+    T pop() {
+        T value;
+        while(!tryPop(value)) {
+            std::this_thread::yield();
+        }
+        return value;
+    }
+private:
+    alignas(64) std::atomic<std::size_t> m_head{0};
+    alignas(64) std::atomic<std::size_t> m_tail{0};
+    alignas(64) std::vector<T> m_slots;
+    std::size_t m_mask;
+};
+
+#endif